@@ -0,0 +1,83 @@
+#!/bin/bash
+#
+#  load stage benchmark of the host simulation build on a deterministic synthetic corpus
+#
+#  ./bench.sh [output file] [seconds]  (default: _bench/bench.tsv, 20 seconds per corpus file)
+#
+#  Every conversion mode loads the corpus (../tools/s44corpus.c, corpus.z44 by ../tools/z44conv.c) BENCH_REPEAT
+#  times and the fastest run of each stage is kept. corpus.z44 must decode back to corpus.s44 byte for byte.
+#  Lines are tab separated, so that two versions can be compared with diff:
+#    profile   <mode> <file> <stage> <usec> <bytes>
+#    checksum  <mode> <file> <bytes> <checksum of the loaded data>
+#    kernel    <kernel> <mode> <KB/s> <ratio to reference> <result>
+#    decoder   <layout> <KB/s> <samples/s> <measured time per byte in 10MHz clocks>  (the C decoder of the host)
+#    speed     <stage> <case> <value> <unit>  (from s44check)
+#
+
+BENCH_DIR=_bench
+OUT_FILE=${1:-${BENCH_DIR}/bench.tsv}
+CORPUS_SEC=${2:-20}
+BENCH_REPEAT=${BENCH_REPEAT:-3}
+BENCH_MODES=("" "-m" "-8" "-2" "-m -8 -2" "-a")
+
+CC=${CC:-gcc}
+
+function make_corpus() {
+  mkdir -p ${BENCH_DIR}
+  ${CC} -O2 -o ${BENCH_DIR}/s44corpus ../tools/s44corpus.c || return 1
+  ${BENCH_DIR}/s44corpus ${BENCH_DIR} ${CORPUS_SEC} || return 1
+  ${CC} -O2 -I../src -o ${BENCH_DIR}/z44conv ../tools/z44conv.c ../src/z44.c || return 1
+  ${BENCH_DIR}/z44conv ${BENCH_DIR}/corpus.s44 ${BENCH_DIR}/corpus.z44 || return 1
+  ${BENCH_DIR}/z44conv -d ${BENCH_DIR}/corpus.z44 ${BENCH_DIR}/corpus.z44.s44 || return 1
+  cmp ${BENCH_DIR}/corpus.s44 ${BENCH_DIR}/corpus.z44.s44 || return 1
+  return 0
+}
+
+#
+#  fastest of the repeated runs of a mode ($1: mode label, $2: options)
+#
+function bench_mode() {
+  for r in `seq ${BENCH_REPEAT}`; do
+    (cd ${BENCH_DIR} && S44SIM_TIME=0 ../_build/s44sim -Pt $2 corpus.s44 corpus.z44 corpus.wav corpus.a44) || return 1
+  done | awk -F '\t' -v mode="$1" '
+    $1 == "profile" {
+      key = $2 "\t" $3
+      if (!(key in usec) || $4 < usec[key]) usec[key] = $4
+      bytes[key] = $5
+      if (!(key in order)) { order[key] = n; keys[n++] = key }
+    }
+    $1 == "checksum" {
+      if (!($2 in sum)) files[m++] = $2
+      sum[$2] = $3 "\t" $4
+    }
+    END {
+      for (i = 0; i < n; i++) printf("profile\t%s\t%s\t%d\t%d\n", mode, keys[i], usec[keys[i]], bytes[keys[i]])
+      for (i = 0; i < m; i++) printf("checksum\t%s\t%s\t%s\n", mode, files[i], sum[files[i]])
+    }'
+}
+
+function bench_kernels() {
+  _build/s44sim -bench | awk '
+    $NF == "ok" || $NF == "MISMATCH" || $NF == "skipped" { printf("kernel\t%s\t%s\t%s\t%s\t%s\n", $1, $2, $3, $4, $5) }
+    $1 == "decoder" && $3 ~ /^[0-9]+$/ { printf("decoder\t%s\t%s\t%s\t%s\n", $2, $3, $4, $5) }'
+}
+
+function bench_stages() {
+  _build/s44check | awk -F '\t' '$1 == "speed"'
+}
+
+function run_bench() {
+  ./make-host.sh check > /dev/null || return 1
+  make_corpus > /dev/null || return 1
+  echo -e "# s44bgp host load benchmark\tcorpus ${CORPUS_SEC} sec\t${BENCH_REPEAT} runs" > ${OUT_FILE}
+  for m in "${BENCH_MODES[@]}"; do
+    label=${m// /}
+    bench_mode "${label:-16bit}" "${m}" >> ${OUT_FILE} || return 1
+  done
+  bench_kernels >> ${OUT_FILE} || return 1
+  bench_stages >> ${OUT_FILE} || return 1
+  echo "wrote ${OUT_FILE}"
+  return 0
+}
+
+run_bench || exit 1
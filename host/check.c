@@ -0,0 +1,782 @@
+//
+//  host checks of the load stages (s44check, run by "./make-host.sh check")
+//
+//  Known signals are fed through the stages of ../src in the byte order of the target memory and the
+//  results are measured against the expected signal. Each check prints a tab separated line
+//    check  <stage> <case> <measure> <value> <limit> ok|FAIL
+//  and each stage its throughput on this host (bench.sh keeps these lines)
+//    speed  <stage> <case> <value> <unit>
+//
+//    resample  SNR of a 1kHz tone and rejection of a tone above the output nyquist frequency
+//              for the wav source rates into every PCM8PP rate, frames/sec
+//    adpcm     SNR of tones encoded by msm6258_encode and decoded as MSM6258 does, input samples/sec
+//    ym2608    a YM2608 ADPCM stream decoded in short partial buffers, with its state saved at a checkpoint (an odd
+//              byte pair in stereo) and restored after decoding other data, equals the stream decoded in one call
+//    convert   tone through every conversion kernel variant and mode (the 68000/68020 variants emulate movep),
+//              SNR and gain of the 16bit or 8bit output, frames/sec
+//    z44       bit exact round trip of a tone with noise, compression ratio, decode MB/s against a raw copy,
+//              and rejection of headers whose frame count does not fit in the file
+//    cache     a metadata cache file with a bad entry count is dropped, an unchanged entry does not mark the
+//              cache for saving
+//    loop      a loop chain of loop.c played by the host PCM8PP in every PCM mode equals the unrolled track sample
+//              for sample, also when it is cut in the last repetition and when it is resumed in the intro or the body
+//    silence   head and tail trimming and the gap chain of silence.c played by the host PCM8PP equal the padded
+//              track without its head and tail, also when resumed inside a gap and after it
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "sample.h"
+#include "resample.h"
+#include "msm6258_encode.h"
+#include "ym2608_decode.h"
+#include "convert.h"
+#include "dosio.h"
+#include "z44.h"
+#include "cache.h"
+#include "pcm8pp.h"
+#include "loop.h"
+#include "silence.h"
+#include "himem.h"
+#include "host.h"
+
+#define CHECK_SEC (2)
+
+static int32_t g_failures;
+
+//
+//  wall clock in sec
+//
+static double get_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//
+//  report a measure against its limit (lower limit when upper is 0)
+//
+static void report(const char* stage, const char* name, const char* measure, double value, double limit, int16_t upper) {
+  int16_t ok = upper ? value <= limit : value >= limit;
+  printf("check\t%s\t%s\t%s\t%.1f\t%s %.1f\t%s\n", stage, name, measure, value, upper ? "<=" : ">=", limit, ok ? "ok" : "FAIL");
+  if (!ok) g_failures++;
+}
+
+static void report_speed(const char* stage, const char* name, double value, const char* unit) {
+  printf("speed\t%s\t%s\t%.0f\t%s\n", stage, name, value, unit);
+}
+
+//
+//  stereo sine tone in memory order (L and R in quadrature)
+//
+static void make_tone(int16_t* buffer, size_t frames, int32_t rate, double freq, double amplitude) {
+  for (size_t i = 0; i < frames; i++) {
+    double a = 2.0 * M_PI * freq * i / rate;
+    buffer[ i * 2 + 0 ] = SAMPLE((int16_t)lrint(amplitude * sin(a)));
+    buffer[ i * 2 + 1 ] = SAMPLE((int16_t)lrint(amplitude * cos(a)));
+  }
+}
+
+//
+//  least squares fit of a tone of a known frequency to one channel of memory order samples
+//  (returns the power of the tone, the residual power is left in *noise)
+//
+static double fit_tone(const int16_t* buffer, size_t frames, int16_t channel, int32_t rate, double freq, double* noise) {
+  double ss = 0.0, cc = 0.0, sc = 0.0, sy = 0.0, cy = 0.0, yy = 0.0;
+  for (size_t i = 0; i < frames; i++) {
+    double a = 2.0 * M_PI * freq * i / rate;
+    double s = sin(a);
+    double c = cos(a);
+    double y = SAMPLE(buffer[ i * 2 + channel ]);
+    ss += s * s;
+    cc += c * c;
+    sc += s * c;
+    sy += s * y;
+    cy += c * y;
+    yy += y * y;
+  }
+  double det = ss * cc - sc * sc;
+  double a = (sy * cc - cy * sc) / det;
+  double b = (cy * ss - sy * sc) / det;
+  double tone = (a * sy + b * cy) / frames;
+  *noise = yy / frames - tone;
+  return tone;
+}
+
+static double to_db(double ratio) {
+  return 10.0 * log10(ratio > 1e-20 ? ratio : 1e-20);
+}
+
+//
+//  resample one tone, returns output frames (the filter start up is skipped)
+//
+static size_t resample_tone(int32_t in_rate, int32_t out_rate, double freq, int16_t* src, int16_t* dst, double* sec) {
+  RESAMPLE_HANDLE rs = { 0 };
+  size_t in_frames = in_rate * CHECK_SEC;
+  make_tone(src, in_frames, in_rate, freq, 16384.0);
+  if (resample_init(&rs, in_rate, out_rate) != 0) return 0;
+  double t0 = get_sec();
+  size_t out_len = resample_exec(&rs, src, in_frames * 2, dst);
+  *sec = get_sec() - t0;
+  resample_close(&rs);
+  return out_len / 2;
+}
+
+//
+//  resampler quality and speed for the wav source rates into the PCM8PP rates
+//
+static void check_resample(void) {
+
+  static const int32_t in_rates[] = { 22050, 24000, 32000, 44100, 48000 };
+  static const int32_t out_rates[] = { 15625, 16000, 22050, 24000, 32000, 44100, 48000 };
+  int16_t* src = malloc(48000 * CHECK_SEC * 4);
+  int16_t* dst = malloc(48000 * CHECK_SEC * 4 * 4);
+  if (src == NULL || dst == NULL) {
+    printf("error: check buffer allocation error.\n");
+    exit(1);
+  }
+
+  for (int16_t i = 0; i < sizeof(in_rates) / sizeof(in_rates[0]); i++) {
+    for (int16_t j = 0; j < sizeof(out_rates) / sizeof(out_rates[0]); j++) {
+
+      int32_t in_rate = in_rates[i];
+      int32_t out_rate = out_rates[j];
+      if (in_rate == out_rate) continue;
+
+      char name[ 32 ];
+      snprintf(name, sizeof(name), "%d-%d", in_rate, out_rate);
+      double sec = 0.0;
+      double noise = 0.0;
+
+      // a tone in the pass band comes out as it is
+      size_t frames = resample_tone(in_rate, out_rate, 1000.0, src, dst, &sec);
+      size_t skip = 64;
+      double tone = fit_tone(dst + skip * 2, frames - skip, 0, out_rate, 1000.0, &noise);
+      report("resample", name, "snr_db", to_db(tone / noise), 50.0, 0);
+      report("resample", name, "gain_db", fabs(to_db(tone / (16384.0 * 16384.0 / 2))), 0.5, 1);
+      report_speed("resample", name, in_rate * CHECK_SEC / sec, "frames/s");
+
+      // a tone above the output nyquist frequency does not fold back into the pass band
+      // (the transition band of 16 taps is wider than the gap between close rates such as 48k to 44.1k,
+      //  where the folded tone stays above 90% of the output nyquist frequency and is only attenuated)
+      if (out_rate < in_rate) {
+        double limit = in_rate * 4 < out_rate * 5 ? -15.0 : -40.0;
+        double high = out_rate * 0.5 + (in_rate * 0.5 - out_rate * 0.5) * 0.75;
+        double alias = out_rate - high;
+        frames = resample_tone(in_rate, out_rate, high, src, dst, &sec);
+        double leak = fit_tone(dst + skip * 2, frames - skip, 0, out_rate, alias, &noise);
+        report("resample", name, "alias_db", to_db(leak / (16384.0 * 16384.0 / 2)), limit, 1);
+      }
+    }
+  }
+
+  free(dst);
+  free(src);
+}
+
+//
+//  MSM6258 decoder written from the data sheet: the step is scaled by the 3 magnitude bits plus 1/8,
+//  each term truncated, and the 12bit output is clamped (returns decoded samples, 12bit)
+//
+static size_t decode_msm6258(const uint8_t* adpcm, size_t bytes, int16_t* out) {
+  static const int16_t index_shift[] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+  int32_t predictor = 0;
+  int32_t step_index = 0;
+  size_t n = 0;
+  for (size_t i = 0; i < bytes * 2; i++) {
+    uint8_t code = (i & 1) ? adpcm[ i / 2 ] >> 4 : adpcm[ i / 2 ] & 0x0f;
+    int32_t step = (int32_t)floor(16.0 * pow(1.1, step_index));
+    int32_t delta = step / 8 + ((code & 4) ? step : 0) + ((code & 2) ? step / 2 : 0) + ((code & 1) ? step / 4 : 0);
+    predictor += (code & 8) ? -delta : delta;
+    predictor = predictor > 2047 ? 2047 : predictor < -2048 ? -2048 : predictor;
+    step_index += index_shift[ code & 7 ];
+    step_index = step_index < 0 ? 0 : step_index > 48 ? 48 : step_index;
+    out[ n++ ] = predictor;
+  }
+  return n;
+}
+
+//
+//  ADPCM encoder quality against the reference decoder and encoder speed
+//
+static void check_adpcm(void) {
+
+  // 4 bits per sample cannot follow a full scale tone at high frequencies (slope overload)
+  static const double freqs[] = { 250.0, 1000.0, 4000.0 };
+  static const double snr_limits[] = { 35.0, 24.0, 14.0 };
+  static const int16_t channels[] = { 1, 2 };
+  size_t frames = MSM6258_SAMPLE_RATE * CHECK_SEC;
+  int16_t* src = malloc(frames * 4);
+  uint8_t* adpcm = malloc(frames);
+  int16_t* dec = malloc(frames * 4);
+  if (src == NULL || adpcm == NULL || dec == NULL) {
+    printf("error: check buffer allocation error.\n");
+    exit(1);
+  }
+
+  for (int16_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+    for (int16_t f = 0; f < sizeof(freqs) / sizeof(freqs[0]); f++) {
+
+      char name[ 32 ];
+      snprintf(name, sizeof(name), "%s-%.0fHz", channels[c] == 1 ? "mono" : "stereo", freqs[f]);
+
+      // stereo sources carry the tone on both channels, mono sources on the first half of the buffer
+      make_tone(src, frames, MSM6258_SAMPLE_RATE, freqs[f], 16384.0);
+      if (channels[c] == 2) {
+        for (size_t i = 0; i < frames; i++) src[ i * 2 + 1 ] = src[ i * 2 ];
+      } else {
+        for (size_t i = 0; i < frames; i++) src[i] = src[ i * 2 ];
+      }
+
+      MSM6258_ENCODE_HANDLE msm;
+      msm6258_encode_init(&msm);
+      double t0 = get_sec();
+      size_t bytes = msm6258_encode_exec(&msm, src, frames * channels[c], channels[c], adpcm);
+      bytes += msm6258_encode_flush(&msm, adpcm + bytes);
+      double sec = get_sec() - t0;
+
+      // decoded 12bit samples back in memory order as 16bit, stereo slots for fit_tone()
+      size_t n = decode_msm6258(adpcm, bytes, dec);
+      for (size_t i = n; i > 0; i--) {
+        dec[ (i - 1) * 2 + 0 ] = dec[ (i - 1) * 2 + 1 ] = SAMPLE((int16_t)(dec[ i - 1 ] << 4));
+      }
+
+      double noise = 0.0;
+      size_t skip = 256;
+      double tone = fit_tone(dec + skip * 2, n - skip, 0, MSM6258_SAMPLE_RATE, freqs[f], &noise);
+      report("adpcm", name, "snr_db", to_db(tone / noise), snr_limits[f], 0);
+      report("adpcm", name, "gain_db", fabs(to_db(tone / (16384.0 * 16384.0 / 2))), 1.0, 1);
+      report_speed("adpcm", name, frames / sec, "samples/s");
+    }
+  }
+
+  free(dec);
+  free(adpcm);
+  free(src);
+}
+
+//
+//  YM2608 ADPCM decoding in pieces and across a saved and restored state against a single call
+//
+static void check_ym2608(void) {
+
+  static const int16_t channels[] = { 1, 2 };
+  size_t bytes = 60001;                 // odd, the last byte of a stereo stream is never decoded
+  size_t checkpoint = 2002;             // byte pair 1001 in stereo
+  uint8_t* adpcm = malloc(bytes);
+  uint8_t* other = malloc(bytes);
+  int16_t* ref = malloc(bytes * 4);
+  int16_t* dec = malloc(bytes * 4);
+  if (adpcm == NULL || other == NULL || ref == NULL || dec == NULL) {
+    printf("error: check buffer allocation error.\n");
+    exit(1);
+  }
+
+  srand(2608);
+  for (size_t i = 0; i < bytes; i++) {
+    adpcm[i] = rand() & 0xff;
+    other[i] = rand() & 0xff;
+  }
+
+  for (int16_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++) {
+
+    char name[ 32 ];
+    YM2608_DECODE_HANDLE nas = { 0 };
+    if (ym2608_decode_init(&nas, bytes * 2, 44100, channels[c]) != 0) {
+      printf("error: check buffer allocation error.\n");
+      exit(1);
+    }
+
+    size_t ref_used = 0;
+    size_t ref_len = ym2608_decode_exec_buffer(&nas, adpcm, bytes, ref, bytes * 2, &ref_used);
+    snprintf(name, sizeof(name), "%s-single", channels[c] == 1 ? "mono" : "stereo");
+    report("ym2608", name, "used_error", abs((int32_t)ref_used - (int32_t)(channels[c] == 1 ? bytes : bytes - 1)), 0.0, 1);
+
+    // buffers of an odd number of samples that take 2 to 98 bytes, stopping at the checkpoint
+    ym2608_decode_reset(&nas);
+    size_t ofs = 0;
+    size_t len = 0;
+    int16_t restored = 0;
+    for (int32_t k = 0; ; k++) {
+      if (ofs == checkpoint && !restored) {
+        YM2608_DECODE_STATE state;
+        ym2608_decode_save(&nas, &state);
+        ym2608_decode_exec_buffer(&nas, other, bytes, nas.decode_buffer, nas.decode_buffer_len, NULL);
+        ym2608_decode_reset(&nas);
+        ym2608_decode_restore(&nas, &state);
+        restored = 1;
+      }
+      size_t avail = bytes - ofs;
+      if (ofs < checkpoint && avail > checkpoint - ofs) avail = checkpoint - ofs;
+      size_t used = 0;
+      size_t n = ym2608_decode_exec_buffer(&nas, adpcm + ofs, avail, dec + len, (k % 97 + 2) * 2 + 1, &used);
+      if (used == 0) break;
+      ofs += used;
+      len += n;
+    }
+
+    snprintf(name, sizeof(name), "%s-partial", channels[c] == 1 ? "mono" : "stereo");
+    report("ym2608", name, "used_error", abs((int32_t)ofs - (int32_t)ref_used), 0.0, 1);
+    size_t mismatch = len != ref_len ? ref_len : 0;
+    for (size_t i = 0; i < len && i < ref_len; i++) {
+      if (dec[i] != ref[i]) mismatch++;
+    }
+    report("ym2608", name, "mismatch", mismatch, 0.0, 1);
+
+    ym2608_decode_close(&nas);
+  }
+
+  free(dec);
+  free(ref);
+  free(other);
+  free(adpcm);
+}
+
+//
+//  conversion kernels on a tone, the output is read back as big endian 16bit or as 8bit samples
+//  (a kernel working in the host byte order gives noise and fails the SNR)
+//
+static void check_convert(void) {
+
+  static CONVERT_KERNEL* kernels[] = { &convert_kernel_68000, &convert_kernel_68020, &convert_kernel_68060 };
+  static const char* mode_names[] = { "stereo", "stereo-half", "mono", "mono-half" };
+  static const int16_t modes[] = { 0, CONVERT_HALF_RATE, CONVERT_MONO, CONVERT_MONO | CONVERT_HALF_RATE };
+  size_t frames = 44100 * CHECK_SEC;
+  int16_t* src = malloc(frames * 4);
+  int16_t* dst = malloc(frames * 4 + 4);
+  int16_t* exp = malloc(frames * 4);
+  if (src == NULL || dst == NULL || exp == NULL) {
+    printf("error: check buffer allocation error.\n");
+    exit(1);
+  }
+
+  make_tone(src, frames, 44100, 1000.0, 16384.0);
+
+  for (int16_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    for (int16_t bits = 16; bits >= 8; bits -= 8) {
+      for (int16_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+
+        char name[ 32 ];
+        snprintf(name, sizeof(name), "%s-%dbit-%s", kernels[k]->name, bits, mode_names[m]);
+
+        // repeated for a measurable time
+        double t0 = get_sec();
+        double sec = 0.0;
+        int32_t loops = 0;
+        size_t len = 0;
+        do {
+          uint32_t frame_count = 0;
+          len = bits == 16 ? kernels[k]->to_16bit(dst, src, frames, modes[m], &frame_count) :
+                             kernels[k]->to_8bit((int8_t*)dst, src, frames, modes[m], &frame_count);
+          loops++;
+          sec = get_sec() - t0;
+        } while (sec < 0.05);
+
+        // output samples back in stereo slots for fit_tone()
+        int16_t channels = (modes[m] & CONVERT_MONO) ? 1 : 2;
+        size_t n = len / channels;
+        for (size_t i = 0; i < n; i++) {
+          for (int16_t c = 0; c < 2; c++) {
+            size_t j = i * channels + (channels == 2 ? c : 0);
+            exp[ i * 2 + c ] = bits == 16 ? dst[j] : SAMPLE((int16_t)(((int8_t*)dst)[j] * 256));
+          }
+        }
+
+        // mono is the mean of the channels in quadrature (-3dB), 8bit output is truncated (a DC offset of -1/2 LSB,
+        // about 38dB SNR in stereo and 35dB in mono on this tone)
+        int32_t rate = (modes[m] & CONVERT_HALF_RATE) ? 22050 : 44100;
+        double expected = 16384.0 * 16384.0 / 2 / (channels == 1 ? 2 : 1);
+        for (int16_t c = 0; c < channels; c++) {
+          double noise = 0.0;
+          double tone = fit_tone(exp, n, c, rate, 1000.0, &noise);
+          char case_name[ 40 ];
+          snprintf(case_name, sizeof(case_name), "%s%s", name, channels == 1 ? "" : c == 0 ? "-l" : "-r");
+          report("convert", case_name, "snr_db", to_db(tone / noise), bits == 16 ? 80.0 : 32.0, 0);
+          report("convert", case_name, "gain_db", fabs(to_db(tone / expected)), bits == 16 ? 0.1 : 0.5, 1);
+        }
+        report_speed("convert", name, frames * loops / sec, "frames/s");
+      }
+    }
+  }
+
+  free(exp);
+  free(dst);
+  free(src);
+}
+
+//
+//  write a z44 header and block index of num_blocks 1 byte raw blocks to a file and try z44_init on it
+//
+static int32_t try_z44_header(const char* file_name, uint32_t num_frames, uint32_t num_blocks) {
+  uint8_t header[ Z44_HEADER_BYTES ] = { 'Z', '4', '4', 0x1a, 0, Z44_VERSION, 0, 2 };
+  uint32_t v[2] = { num_frames, Z44_BLOCK_FRAMES };
+  for (int16_t i = 0; i < 8; i++) header[ 8 + i ] = (uint8_t)(v[ i / 4 ] >> (24 - (i & 3) * 8));
+  FILE* fp = fopen(file_name, "wb");
+  if (fp == NULL) return -1;
+  fwrite(header, 1, Z44_HEADER_BYTES, fp);
+  for (uint32_t i = 0; i < num_blocks; i++) fwrite("\0\0\0\x01", 1, 4, fp);
+  for (uint32_t i = 0; i < num_blocks; i++) fputc(Z44_BLOCK_RAW, fp);
+  fclose(fp);
+  DOSIO_HANDLE io = { 0 };
+  Z44_HANDLE z44 = { 0 };
+  int32_t rc = dosio_open(&io, (const uint8_t*)file_name);
+  if (rc == 0) rc = z44_init(&z44, &io);
+  z44_close(&z44);
+  dosio_close(&io);
+  remove(file_name);
+  return rc;
+}
+
+//
+//  z44 round trip, compression ratio, decode speed and header validation
+//
+static void check_z44(void) {
+
+  size_t frames = 44100 * CHECK_SEC;
+  size_t num_blocks = (frames + Z44_BLOCK_FRAMES - 1) / Z44_BLOCK_FRAMES;
+  int16_t* src = malloc(frames * 4);
+  int16_t* dst = malloc(frames * 4);
+  uint8_t* z = malloc(num_blocks * Z44_MAX_BLOCK_BYTES);
+  uint32_t* block_bytes = malloc(num_blocks * sizeof(uint32_t));
+  if (src == NULL || dst == NULL || z == NULL || block_bytes == NULL) {
+    printf("error: check buffer allocation error.\n");
+    exit(1);
+  }
+
+  // 440Hz tone with -40dB noise
+  make_tone(src, frames, 44100, 440.0, 16384.0);
+  srand(44100);
+  for (size_t i = 0; i < frames * 2; i++) src[i] = SAMPLE((int16_t)(SAMPLE(src[i]) + rand() % 327 - 163));
+
+  size_t z_bytes = 0;
+  for (size_t i = 0; i < num_blocks; i++) {
+    size_t n = i == num_blocks - 1 ? frames - i * Z44_BLOCK_FRAMES : Z44_BLOCK_FRAMES;
+    block_bytes[i] = z44_encode_block(src + i * Z44_BLOCK_FRAMES * 2, n, z + z_bytes);
+    z_bytes += block_bytes[i];
+  }
+
+  double t0 = get_sec();
+  size_t len = 0;
+  uint8_t* block = z;
+  for (size_t i = 0; i < num_blocks; i++) {
+    size_t n = i == num_blocks - 1 ? frames - i * Z44_BLOCK_FRAMES : Z44_BLOCK_FRAMES;
+    len += z44_decode_block(block, n, dst + len);
+    block += block_bytes[i];
+  }
+  double sec = get_sec() - t0;
+
+  report("z44", "tone-noise", "mismatch", len == frames * 2 ? memcmp(src, dst, frames * 4) != 0 : 1, 0.0, 1);
+  report("z44", "tone-noise", "ratio_pct", z_bytes * 100.0 / (frames * 4), 80.0, 1);
+  report_speed("z44", "decode", frames * 4 / sec / 1e6, "MB/s");
+
+  // the raw .s44 load has a copy of the same bytes at this point
+  t0 = get_sec();
+  memcpy(dst, src, frames * 4);
+  sec = get_sec() - t0;
+  report_speed("z44", "raw-copy", frames * 4 / sec / 1e6, "MB/s");
+
+  // a frame count beyond the blocks in the file or close to 2^32 is rejected, a consistent one is accepted
+  char file_name[] = "/tmp/s44check-XXXXXX";
+  int fd = mkstemp(file_name);
+  if (fd >= 0) close(fd);
+  report("z44", "header-valid", "rc", try_z44_header(file_name, Z44_BLOCK_FRAMES * 4, 4), 0.0, 1);
+  report("z44", "header-frames", "rc", try_z44_header(file_name, Z44_BLOCK_FRAMES * 4 + 1, 4), -1.0, 1);
+  report("z44", "header-overflow", "rc", try_z44_header(file_name, 0xffffffff, 4), -1.0, 1);
+
+  free(block_bytes);
+  free(z);
+  free(dst);
+  free(src);
+}
+
+//
+//  write a metadata cache file header with an entry count and the given entries
+//
+static void write_cache(const char* file_name, uint16_t num_entries, const CACHE_ENTRY* entries, int16_t num_written) {
+  uint8_t header[ 10 ] = { 'S', '4', '4', 'C', CACHE_VERSION >> 8, CACHE_VERSION & 0xff,
+    sizeof(CACHE_ENTRY) >> 8, sizeof(CACHE_ENTRY) & 0xff, num_entries >> 8, num_entries & 0xff };
+  FILE* fp = fopen(file_name, "wb");
+  if (fp == NULL) return;
+  fwrite(header, 1, 10, fp);
+  fwrite(entries, sizeof(CACHE_ENTRY), num_written, fp);
+  fclose(fp);
+}
+
+//
+//  metadata cache header validation and saving only on changes
+//
+static void check_cache(void) {
+
+  char pcm_name[] = "/tmp/s44check-XXXXXX";
+  char cache_name[] = "/tmp/s44check-XXXXXX";
+  int fd = mkstemp(pcm_name);
+  if (fd >= 0) close(fd);
+  fd = mkstemp(cache_name);
+  if (fd >= 0) close(fd);
+
+  CACHE_ENTRY entry;
+  memset(&entry, 0, sizeof(CACHE_ENTRY));
+  strcpy(entry.file_name, pcm_name);
+  entry.format = CACHE_FORMAT_S44;
+  entry.kmd_events = -1;
+
+  // a count of 0x8000 or more was negative as int16_t and passed the MAX_MUSIC check
+  CACHE_HANDLE cache = { 0 };
+  write_cache(cache_name, 0x8000, &entry, 1);
+  int32_t rc = cache_open(&cache, cache_name);
+  report("cache", "count-negative", "entries", rc == 0 ? cache.num_entries : -1, 0.0, 1);
+  cache_close(&cache);
+  write_cache(cache_name, MAX_MUSIC + 1, &entry, 1);
+  rc = cache_open(&cache, cache_name);
+  report("cache", "count-over", "entries", rc == 0 ? cache.num_entries : -1, 0.0, 1);
+
+  // a new entry, then the same entry again from a valid lookup, then a changed one
+  cache_update(&cache, &entry, NULL);
+  int16_t new_updated = cache.updated;
+  cache.updated = 0;
+  CACHE_ENTRY* valid = cache_lookup(&cache, entry.file_name, 0);
+  report("cache", "lookup-valid", "found", valid != NULL, 1.0, 0);
+  if (valid != NULL) cache_update(&cache, &entry, valid);
+  int16_t same_updated = cache.updated;
+  entry.total_time_msec = 1000;
+  if (valid != NULL) cache_update(&cache, &entry, valid);
+  report("cache", "update-new", "updated", new_updated, 1.0, 0);
+  report("cache", "update-same", "updated", same_updated, 0.0, 1);
+  report("cache", "update-changed", "updated", cache.updated, 1.0, 0);
+  cache_close(&cache);
+
+  remove(cache_name);
+  remove(pcm_name);
+}
+
+//
+//  PCM8PP modes of the player (volume 8 is unity), bytes per frame and sample rates
+//
+static const char* g_pcm_mode_names[] = { "16bit-stereo", "16bit-mono", "8bit-stereo", "8bit-mono", "16bit-stereo-half", "8bit-mono-half" };
+static const uint8_t g_pcm_mode_freqs[] = { 0x1d, 0x0d, 0x25, 0x15, 0x1a, 0x12 };
+static const int16_t g_pcm_mode_frame_bytes[] = { 4, 2, 2, 1, 4, 1 };
+static const int32_t g_pcm_mode_rates[] = { 44100, 44100, 44100, 44100, 22050, 22050 };
+#define NUM_PCM_MODES (sizeof(g_pcm_mode_freqs) / sizeof(g_pcm_mode_freqs[0]))
+
+//
+//  output frames of the host PCM8PP for source frames of a mode
+//
+static uint32_t get_out_frames(int16_t m, uint32_t frames) {
+  return (uint64_t)frames * 44100 / g_pcm_mode_rates[m];
+}
+
+//
+//  output frames that differ between two renderings
+//
+static uint32_t count_mismatch(const int16_t* a, const int16_t* b, uint32_t frames) {
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < frames; i++) {
+    if (a[ i * 2 ] != b[ i * 2 ] || a[ i * 2 + 1 ] != b[ i * 2 + 1 ]) n++;
+  }
+  return n;
+}
+
+//
+//  render the channel started by the caller for a number of output frames and stop it
+//
+static void render(int16_t* out, uint32_t frames) {
+  host_pcm8pp_render(out, frames);
+  pcm8pp_stop();
+}
+
+//
+//  loop chains against the unrolled track (intro and body span several links, the body is an odd number of frames)
+//
+static void check_loop(void) {
+
+  static LOOP_PLAYER lp;
+  uint32_t intro_frames = 40000;
+  uint32_t body_frames = 30011;
+  uint32_t max_bytes = (intro_frames + body_frames * 3) * 4;
+  uint32_t max_out = (intro_frames + body_frames * 3) * 2 + 1000;
+  uint8_t* unrolled = malloc(max_bytes);
+  int16_t* out = malloc(max_out * 4);
+  int16_t* ref = malloc(max_out * 4);
+  if (unrolled == NULL || out == NULL || ref == NULL) {
+    printf("error: check buffer allocation error.\n");
+    exit(1);
+  }
+
+  for (int16_t m = 0; m < NUM_PCM_MODES; m++) {
+
+    uint32_t fb = g_pcm_mode_frame_bytes[m];
+    uint32_t mode = (8 << 16) | (g_pcm_mode_freqs[m] << 8) | 0x03;
+    uint32_t loop_start = intro_frames * fb;
+    uint32_t loop_end = (intro_frames + body_frames) * fb;
+    uint32_t body_bytes = loop_end - loop_start;
+    char name[ 40 ];
+
+    // the buffer is the intro and one body, the unrolled track has three bodies
+    srand(44100 + m);
+    for (uint32_t i = 0; i < loop_end; i++) unrolled[i] = rand();
+    for (int16_t r = 1; r < 3; r++) memcpy(unrolled + loop_end + body_bytes * (r - 1), unrolled + loop_start, body_bytes);
+
+    // joins of two and a half repetitions
+    uint32_t n = get_out_frames(m, intro_frames + body_frames * 5 / 2);
+    pcm8pp_play(0, mode, loop_end + body_bytes * 2, 44100*256, unrolled);
+    render(ref, n);
+    loop_play(&lp, 0, mode, 44100*256, unrolled, loop_start, loop_end);
+    render(out, n);
+    snprintf(name, sizeof(name), "%s-join", g_pcm_mode_names[m]);
+    report("loop", name, "mismatch", count_mismatch(out, ref, n), 0.0, 1);
+
+    // cut in the second repetition, which plays to its end
+    uint32_t n_cut = get_out_frames(m, intro_frames + body_frames * 3 / 2);
+    n = get_out_frames(m, intro_frames + body_frames * 3) + 1000;
+    pcm8pp_play(0, mode, loop_end + body_bytes, 44100*256, unrolled);
+    render(ref, n);
+    loop_play(&lp, 0, mode, 44100*256, unrolled, loop_start, loop_end);
+    host_pcm8pp_render(out, n_cut);
+    loop_cut(&lp);
+    render(out + n_cut * 2, n - n_cut);
+    snprintf(name, sizeof(name), "%s-cut", g_pcm_mode_names[m]);
+    report("loop", name, "mismatch", count_mismatch(out, ref, n), 0.0, 1);
+
+    // resumed near the end of the intro and in the second repetition of the body, through the next join
+    uint32_t resume_frames[] = { intro_frames - 1000, intro_frames + body_frames + body_frames / 3 };
+    for (int16_t r = 0; r < 2; r++) {
+      uint32_t ofs = resume_frames[r] * fb;
+      n = get_out_frames(m, body_frames * 3 / 2);
+      pcm8pp_play(0, mode, loop_end + body_bytes * 2 - ofs, 44100*256, unrolled + ofs);
+      render(ref, n);
+      loop_play(&lp, 0, mode, 44100*256, unrolled, loop_start, loop_end);
+      pcm8pp_stop();
+      loop_resume(&lp, 0, mode, 44100*256, ofs);
+      render(out, n);
+      snprintf(name, sizeof(name), "%s-resume-%s", g_pcm_mode_names[m], r == 0 ? "intro" : "body");
+      report("loop", name, "mismatch", count_mismatch(out, ref, n), 0.0, 1);
+    }
+  }
+
+  free(ref);
+  free(out);
+  free(unrolled);
+}
+
+//
+//  silence trimming and gap chains against the padded track (a gap of several zero block links, a short one that is
+//  kept, and digital silence in the padding, so that the output is the same sample for sample)
+//
+static void check_silence(void) {
+
+  // head, sound, long gap, sound, short gap, sound, tail in frames
+  static const uint32_t parts[] = { 20000, 50000, 100000, 30000, 10000, 30000, 20000 };
+  #define NUM_PARTS (sizeof(parts) / sizeof(parts[0]))
+  static const int16_t modes[] = { 0, 3 };    // 16bit stereo and 8bit mono of g_pcm_mode_*
+  uint32_t total_frames = 0;
+  for (int16_t i = 0; i < NUM_PARTS; i++) total_frames += parts[i];
+
+  uint8_t* padded = malloc(total_frames * 4);
+  uint8_t* buffer = malloc(total_frames * 4);
+  uint8_t* zero_block = calloc(SILENCE_LINK_BYTES, 1);
+  int16_t* out = malloc((total_frames + 1000) * 4);
+  int16_t* ref = malloc((total_frames + 1000) * 4);
+  if (padded == NULL || buffer == NULL || zero_block == NULL || out == NULL || ref == NULL) {
+    printf("error: check buffer allocation error.\n");
+    exit(1);
+  }
+
+  for (int16_t k = 0; k < sizeof(modes) / sizeof(modes[0]); k++) {
+
+    int16_t m = modes[k];
+    uint32_t fb = g_pcm_mode_frame_bytes[m];
+    int16_t bits = m == 0 ? 16 : 8;
+    uint32_t mode = (8 << 16) | (g_pcm_mode_freqs[m] << 8) | 0x03;
+    uint32_t bytes = total_frames * fb;
+    char name[ 40 ];
+
+    // sounding parts never fall within the silence level
+    srand(44100 + m);
+    uint32_t ofs = 0;
+    for (int16_t i = 0; i < NUM_PARTS; i++) {
+      for (uint32_t j = 0; j < parts[i] * fb; j += bits / 8) {
+        if (i & 1) {
+          int16_t v = (rand() % 20000 + SILENCE_LEVEL * 2) * (rand() & 1 ? 1 : -1);
+          if (bits == 16) *(int16_t*)(padded + ofs + j) = SAMPLE(v);
+          else padded[ ofs + j ] = 1 + rand() % 254;
+        } else {
+          if (bits == 16) *(int16_t*)(padded + ofs + j) = 0;
+          else padded[ ofs + j ] = 0;
+        }
+      }
+      ofs += parts[i] * fb;
+    }
+    memcpy(buffer, padded, bytes);
+
+    static SILENCE_MAP map;
+    silence_scan(&map, buffer, bytes, fb, bits, 44100 * fb * SILENCE_MIN_GAP_MSEC / 1000);
+    snprintf(name, sizeof(name), "%s-head", g_pcm_mode_names[m]);
+    report("silence", name, "error_bytes", abs((int32_t)(map.head_bytes - parts[0] * fb)), 0.0, 1);
+    snprintf(name, sizeof(name), "%s-tail", g_pcm_mode_names[m]);
+    report("silence", name, "error_bytes", abs((int32_t)(map.tail_bytes - parts[ NUM_PARTS - 1 ] * fb)), 0.0, 1);
+    snprintf(name, sizeof(name), "%s-gaps", g_pcm_mode_names[m]);
+    report("silence", name, "error", abs(map.num_gaps - 1) + (map.num_gaps == 1 && map.gap_len[0] != parts[2] * fb), 0.0, 1);
+
+    uint32_t sound_bytes = silence_compact(&map, buffer);
+    PCM8PP_LINK* links = silence_make_links(&map, buffer, sound_bytes, zero_block);
+    if (links == NULL) {
+      printf("error: check buffer allocation error.\n");
+      exit(1);
+    }
+
+    // the chain from the top, the padded track without head and tail
+    uint8_t* trimmed = padded + map.head_bytes;
+    uint32_t trimmed_bytes = bytes - map.head_bytes - map.tail_bytes;
+    uint32_t n = trimmed_bytes / fb + 1000;
+    pcm8pp_play(0, mode, trimmed_bytes, 44100*256, trimmed);
+    render(ref, n);
+    pcm8pp_play_linked_array_chain(0, mode, 0, 44100*256, links);
+    render(out, n);
+    snprintf(name, sizeof(name), "%s-chain", g_pcm_mode_names[m]);
+    report("silence", name, "mismatch", count_mismatch(out, ref, n), 0.0, 1);
+
+    // resumed in the middle of the long gap and in the last sounding part (offsets of the chain, gaps included)
+    static PCM8PP_LINK resume_link;
+    uint32_t resume_frames[] = { parts[1] + parts[2] / 2, parts[1] + parts[2] + parts[3] + parts[4] + parts[5] / 2 };
+    for (int16_t r = 0; r < 2; r++) {
+      uint32_t resume_ofs = resume_frames[r] * fb;
+      n = (trimmed_bytes - resume_ofs) / fb + 1000;
+      pcm8pp_play(0, mode, trimmed_bytes - resume_ofs, 44100*256, trimmed + resume_ofs);
+      render(ref, n);
+      silence_resume(links, &resume_link, 0, mode, 44100*256, resume_ofs);
+      render(out, n);
+      snprintf(name, sizeof(name), "%s-resume-%s", g_pcm_mode_names[m], r == 0 ? "gap" : "sound");
+      report("silence", name, "mismatch", count_mismatch(out, ref, n), 0.0, 1);
+    }
+
+    himem_free(links, 0);
+  }
+
+  free(ref);
+  free(out);
+  free(zero_block);
+  free(buffer);
+  free(padded);
+}
+
+//
+//  main
+//
+int main(int argc, char* argv[]) {
+
+  check_resample();
+  check_adpcm();
+  check_ym2608();
+  check_convert();
+  check_z44();
+  check_cache();
+  check_loop();
+  check_silence();
+
+  printf("%s\n", g_failures == 0 ? "all checks passed." : "some checks FAILED.");
+  return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+//
+//  disk IOCS call hooks for the host simulation build
+//
+//  C version of ../src/diskhook.s, there are no IOCS disk calls in the simulation, the hooks are never called
+//  and the busy count stays 0.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include "diskhook.h"
+
+static void diskhook_entry(void) {
+}
+
+const uint16_t diskhook_calls[ DISKHOOK_CALLS ] = { 0x45, 0x46, 0xf5 };
+void* diskhook_entries[ DISKHOOK_CALLS ] = { (void*)diskhook_entry, (void*)diskhook_entry, (void*)diskhook_entry };
+void* diskhook_old_vectors[ DISKHOOK_CALLS ];
+volatile uint16_t diskhook_busy;
@@ -0,0 +1,41 @@
+#ifndef __H_HOST_DOSLIB__
+#define __H_HOST_DOSLIB__
+
+//
+//  XC doslib.h subset for the host simulation build (implemented in x68k.c)
+//
+#include <stdint.h>
+
+extern uint32_t _PSP;
+
+struct FILBUF {
+  uint8_t atr;
+  uint16_t time;
+  uint16_t date;
+  uint32_t filelen;
+  uint8_t name[ 23 ];
+};
+
+struct NAMECKBUF {
+  uint8_t drive[ 2 ];
+  uint8_t path[ 65 ];
+  uint8_t name[ 19 ];
+  uint8_t ext[ 5 ];
+};
+
+int32_t OPEN(const uint8_t* file_name, int32_t mode);
+int32_t READ(int32_t fd, void* buffer, int32_t bytes);
+int32_t SEEK(int32_t fd, int32_t ofs, int32_t mode);
+int32_t CLOSE(int32_t fd);
+int32_t FILES(struct FILBUF* filbuf, const uint8_t* file_name, int32_t atr);
+int32_t NAMECK(const uint8_t* file_name, struct NAMECKBUF* nameck);
+void* GETPDB(void);
+void* SETPDB(void* pdb);
+void* INDOSFLG(void);
+int32_t MFREE(uint32_t addr);
+void KEEPPR(uint32_t size, int32_t rc);
+int32_t C_FNKMOD(int32_t mode);
+void* INTVCS(int32_t vector, void* handler);
+int32_t GETTIM2(void);
+
+#endif
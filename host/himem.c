@@ -0,0 +1,67 @@
+//
+//  high memory / main memory allocator for the host simulation build
+//
+//  Allocations are served by malloc() and accounted against a virtual high memory size
+//  (S44SIM_HIMEM_KB, default 12288) so that out of memory paths and peak usage can be checked.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "himem.h"
+#include "host.h"
+
+typedef struct {
+  size_t size;
+  size_t pad;
+} HOST_BLOCK;
+
+static size_t g_used[2];
+static size_t g_peak[2];
+static uint32_t g_allocs[2];
+
+static size_t himem_total(void) {
+  const char* env = getenv("S44SIM_HIMEM_KB");
+  return (env != NULL ? strtoul(env, NULL, 10) : 12288) * 1024;
+}
+
+void* himem_malloc(size_t size, int32_t use_high_memory) {
+  int16_t m = use_high_memory ? 1 : 0;
+  if (m && g_used[m] + size > himem_total()) return NULL;
+  HOST_BLOCK* b = malloc(sizeof(HOST_BLOCK) + size);
+  if (b == NULL) return NULL;
+  b->size = size;
+  g_used[m] += size;
+  if (g_used[m] > g_peak[m]) g_peak[m] = g_used[m];
+  g_allocs[m]++;
+  return b + 1;
+}
+
+void himem_free(void* ptr, int32_t use_high_memory) {
+  if (ptr == NULL) return;
+  HOST_BLOCK* b = (HOST_BLOCK*)ptr - 1;
+  g_used[ use_high_memory ? 1 : 0 ] -= b->size;
+  free(b);
+}
+
+size_t himem_getsize(int32_t use_high_memory) {
+  return use_high_memory ? himem_total() - g_used[1] : 0;
+}
+
+int32_t himem_resize(void* ptr, size_t size, int32_t use_high_memory) {
+  // shrinking in place only
+  HOST_BLOCK* b = (HOST_BLOCK*)ptr - 1;
+  if (size > b->size) return -1;
+  g_used[ use_high_memory ? 1 : 0 ] -= b->size - size;
+  b->size = size;
+  return 0;
+}
+
+int32_t himem_isavailable(void) {
+  return 1;
+}
+
+void host_himem_report(void) {
+  printf("high memory: %d [KB] in use, %d [KB] peak, %d allocations\n", g_used[1] / 1024, g_peak[1] / 1024, g_allocs[1]);
+  printf("main memory: %d [KB] in use, %d [KB] peak, %d allocations\n", g_used[0] / 1024, g_peak[0] / 1024, g_allocs[0]);
+}
@@ -0,0 +1,22 @@
+#ifndef __H_HOST__
+#define __H_HOST__
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+//  host simulation backend internals (not visible from src/)
+//
+void host_pcm8pp_open(const char* wav_file);
+void host_pcm8pp_close(void);
+void host_pcm8pp_advance(uint32_t usec);
+void host_pcm8pp_render(int16_t* buffer, uint32_t frames);
+uint32_t host_pcm8pp_get_play_count(void);
+uint32_t host_pcm8pp_get_played_msec(void);
+void host_pcm8pp_report(void);
+
+void host_himem_report(void);
+
+uint32_t host_get_sim_time(void);
+
+#endif
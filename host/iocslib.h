@@ -0,0 +1,20 @@
+#ifndef __H_HOST_IOCSLIB__
+#define __H_HOST_IOCSLIB__
+
+//
+//  XC iocslib.h subset for the host simulation build (implemented in x68k.c)
+//
+#include <stdint.h>
+
+int32_t ONTIME(void);
+int32_t B_SFTSNS(void);
+int32_t BITSNS(int32_t group);
+int32_t B_PUTMES(int32_t color, int32_t x, int32_t y, int32_t len, const void* message);
+uint32_t B_LPEEK(const void* addr);
+uint8_t B_BPEEK(const void* addr);
+int32_t OPMSNS(void);
+int32_t OPMSET(int32_t reg, int32_t data);
+int32_t OPMINTST(void* handler);
+int32_t TIMERDST(void* handler, int32_t mode, int32_t count);
+
+#endif
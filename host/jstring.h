@@ -0,0 +1,12 @@
+#ifndef __H_HOST_JSTRING__
+#define __H_HOST_JSTRING__
+
+//
+//  XC jstring.h subset for the host simulation build (no SJIS awareness)
+//
+#include <string.h>
+
+#define jstrchr(s, c)  ((uint8_t*)strchr((const char*)(s), (c)))
+#define jstrrchr(s, c) ((uint8_t*)strrchr((const char*)(s), (c)))
+
+#endif
@@ -0,0 +1,17 @@
+//
+//  keyboard interrupt hook for the host simulation build
+//
+//  C version of ../src/keyhook.s, the virtual keyboard of x68k.c calls the hooked vector as a plain function
+//  and there is no original IOCS handler to chain to.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include "keyhook.h"
+
+void* keyhook_old_vector;
+void (*keyhook_callback)(void);
+
+void keyhook_entry(void) {
+  if (keyhook_old_vector != NULL) ((void (*)(void))keyhook_old_vector)();
+  if (keyhook_callback != NULL) keyhook_callback();
+}
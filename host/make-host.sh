@@ -0,0 +1,81 @@
+#!/bin/bash
+#
+#  build the host simulation binary (s44sim) with the native gcc
+#
+#  the player sources in ../src are compiled as they are, with DOS/IOCS calls, PCM8PP, high memory
+#  and the 68000 ADPCM routines replaced by the Linux backend in this directory
+#
+
+TARGET_FILE="s44sim"
+CHECK_FILE="s44check"
+
+CC=${CC:-gcc}
+CFLAGS="-O2 -std=gnu99 -D__HOST_SIM__ -Dstricmp=strcasecmp -I. -I../src \
+    -Wno-pointer-sign -Wno-format -Wno-int-to-pointer-cast -Wno-pointer-to-int-cast -Wno-main"
+
+SRC_FILES="resident refill kmd dosio wav z44 resample msm6258_encode profile profile_print cache stream trackcache loop silence trace trace_dump convert loudness main"
+HOST_FILES="x68k pcm8pp himem ym2608_decode keyhook diskhook"
+CONVERT_VARIANTS="68000 68020 68060"
+
+function build_s44sim() {
+  rm -rf _build
+  mkdir -p _build
+  for c in ${SRC_FILES}; do
+    echo "compiling ${c}.c in ../src"
+    ${CC} -c ${CFLAGS} -o _build/${c}.o ../src/${c}.c || return 1
+  done
+  for v in ${CONVERT_VARIANTS}; do
+    echo "compiling convert_kernel.c in ../src for ${v}"
+    ${CC} -c ${CFLAGS} -DCONVERT_VARIANT=${v} -o _build/convert_kernel_${v}.o ../src/convert_kernel.c || return 1
+  done
+  for c in ${HOST_FILES}; do
+    echo "compiling ${c}.c"
+    ${CC} -c ${CFLAGS} -o _build/host_${c}.o ${c}.c || return 1
+  done
+  ${CC} -o _build/${TARGET_FILE} _build/*.o || return 1
+  return 0
+}
+
+#
+#  host checks of the load stages, linked with the same objects except main ("./make-host.sh check")
+#
+function build_s44check() {
+  mkdir -p _build/check
+  echo "compiling check.c"
+  ${CC} -c ${CFLAGS} -o _build/check/check.o check.c || return 1
+  ${CC} -o _build/${CHECK_FILE} _build/check/check.o `ls _build/*.o | grep -v '/main.o$'` -lm || return 1
+  return 0
+}
+
+#
+#  cross-check every conversion kernel variant against the portable reference ("./make-host.sh check")
+#
+function check_s44sim() {
+  for mpu in 0 3 6; do
+    echo "checking conversion kernels for MPU type ${mpu}"
+    S44SIM_MPU=${mpu} _build/${TARGET_FILE} -bench || return 1
+  done
+  _build/${CHECK_FILE} || return 1
+  return 0
+}
+
+#
+#  the target links without FLOATFNC.L, so no source may use floating point ("./make-host.sh check",
+#  -mgeneral-regs-only of the x86 gcc rejects any float or double code)
+#
+function check_no_float() {
+  for c in ${SRC_FILES}; do
+    ${CC} -c ${CFLAGS} -mgeneral-regs-only -o /dev/null ../src/${c}.c 2> /dev/null || { echo "error: floating point in ${c}.c"; return 1; }
+  done
+  for v in ${CONVERT_VARIANTS}; do
+    ${CC} -c ${CFLAGS} -mgeneral-regs-only -DCONVERT_VARIANT=${v} -o /dev/null ../src/convert_kernel.c 2> /dev/null || { echo "error: floating point in convert_kernel.c"; return 1; }
+  done
+  return 0
+}
+
+build_s44sim || exit 1
+if [ "$1" == "check" ]; then
+  build_s44check || exit 1
+  check_no_float || exit 1
+  check_s44sim || exit 1
+fi
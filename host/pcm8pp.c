@@ -0,0 +1,321 @@
+//
+//  virtual PCM8PP for the host simulation build
+//
+//  Channels consume their buffers at the rate given by the mode word and are mixed into
+//  44.1kHz 16bit stereo (nearest sample, volume 8 is unity and scaled linearly).
+//  Paused or idle time is written as silence so that the wav timeline matches the virtual clock.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "pcm8pp.h"
+#include "host.h"
+
+#define MAX_CHANNELS (8)
+#define OUT_RATE (44100)
+
+typedef struct {
+  uint32_t mode;
+  uint8_t* addr;
+  uint32_t remain;
+  uint32_t phase;             // 16.16 fraction of the next source sample
+  PCM8PP_LINK* link;          // current entry in linked array chain mode
+  int16_t l;
+  int16_t r;
+  int16_t adpcm_predictor;
+  int16_t adpcm_step_index;
+  int16_t adpcm_high_nibble;
+} HOST_CHANNEL;
+
+static HOST_CHANNEL g_channels[ MAX_CHANNELS ];
+static int16_t g_paused;
+static uint32_t g_frac_usec;
+static uint32_t g_play_count;
+static uint32_t g_stop_count;
+static uint64_t g_played_frames;
+static uint64_t g_out_frames;
+
+static FILE* g_wav_fp;
+static uint32_t g_wav_bytes;
+
+static const int32_t pcm_rates[] = { 15625, 16000, 22050, 24000, 32000, 44100, 48000, 44100 };
+static const int32_t adpcm_rates[] = { 3906, 5208, 7812, 10416, 15625, 15625, 15625, 15625 };
+
+static const int16_t msm6258_steps[] = {
+    16,   17,   19,   21,   23,   25,   28,   31,   34,   37,   41,   45,   50,   55,   60,   66,
+    73,   80,   88,   97,  107,  118,  130,  143,  157,  173,  190,  209,  230,  253,  279,  307,
+   337,  371,  408,  449,  494,  544,  598,  658,  724,  796,  876,  963, 1060, 1166, 1282, 1411,
+  1552,
+};
+
+static const int16_t msm6258_index_shift[] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+//
+//  mode word fields
+//
+static int16_t mode_volume(uint32_t mode) { return (mode >> 16) & 0xff; }
+static int16_t mode_freq(uint32_t mode)   { return (mode >> 8) & 0xff; }
+static int16_t mode_type(uint32_t mode)   { return mode_freq(mode) >> 3; }  // 0:ADPCM 1:16bit 2:8bit 3:16bit stereo 4:8bit stereo
+
+static int32_t mode_rate(uint32_t mode) {
+  return mode_type(mode) == 0 ? adpcm_rates[ mode_freq(mode) & 0x07 ] : pcm_rates[ mode_freq(mode) & 0x07 ];
+}
+
+//
+//  fetch the next source sample of a channel
+//
+static void fetch_sample(HOST_CHANNEL* ch) {
+
+  uint8_t* p = ch->addr;
+
+  switch (mode_type(ch->mode)) {
+    case 0: {
+      uint8_t code = ch->adpcm_high_nibble ? (p[0] >> 4) : (p[0] & 0x0f);
+      int16_t step = msm6258_steps[ ch->adpcm_step_index ];
+      int16_t delta = step >> 3;
+      if (code & 4) delta += step;
+      if (code & 2) delta += step >> 1;
+      if (code & 1) delta += step >> 2;
+      int16_t predictor = (code & 8) ? ch->adpcm_predictor - delta : ch->adpcm_predictor + delta;
+      ch->adpcm_predictor = predictor > 2047 ? 2047 : predictor < -2048 ? -2048 : predictor;
+      int16_t step_index = ch->adpcm_step_index + msm6258_index_shift[ code & 7 ];
+      ch->adpcm_step_index = step_index < 0 ? 0 : step_index > 48 ? 48 : step_index;
+      ch->l = ch->r = ch->adpcm_predictor << 4;
+      ch->adpcm_high_nibble ^= 1;
+      if (!ch->adpcm_high_nibble) {
+        ch->addr++;
+        ch->remain--;
+      }
+      break;
+    }
+    case 1:
+      ch->l = ch->r = (int16_t)((p[0] << 8) | p[1]);
+      ch->addr += 2;
+      ch->remain = ch->remain >= 2 ? ch->remain - 2 : 0;
+      break;
+    case 2:
+      ch->l = ch->r = (int16_t)(p[0] << 8);
+      ch->addr += 1;
+      ch->remain--;
+      break;
+    case 3:
+      ch->l = (int16_t)((p[0] << 8) | p[1]);
+      ch->r = (int16_t)((p[2] << 8) | p[3]);
+      ch->addr += 4;
+      ch->remain = ch->remain >= 4 ? ch->remain - 4 : 0;
+      break;
+    default:
+      ch->l = (int16_t)(p[0] << 8);
+      ch->r = (int16_t)(p[1] << 8);
+      ch->addr += 2;
+      ch->remain = ch->remain >= 2 ? ch->remain - 2 : 0;
+      break;
+  }
+
+  // linked array chain mode follows the link at the end of each entry (as it is at that moment)
+  while (ch->remain == 0 && ch->link != NULL && ch->link->next != NULL) {
+    ch->link = ch->link->next;
+    ch->addr = (uint8_t*)ch->link->addr;
+    ch->remain = ch->link->length;
+  }
+}
+
+//
+//  little endian writers
+//
+static void write_le32(FILE* fp, uint32_t v) {
+  fputc(v & 0xff, fp);
+  fputc((v >> 8) & 0xff, fp);
+  fputc((v >> 16) & 0xff, fp);
+  fputc((v >> 24) & 0xff, fp);
+}
+
+static void write_le16(FILE* fp, uint16_t v) {
+  fputc(v & 0xff, fp);
+  fputc((v >> 8) & 0xff, fp);
+}
+
+static void write_wav_header(FILE* fp, uint32_t data_bytes) {
+  fwrite("RIFF", 1, 4, fp);
+  write_le32(fp, 36 + data_bytes);
+  fwrite("WAVEfmt ", 1, 8, fp);
+  write_le32(fp, 16);
+  write_le16(fp, 1);
+  write_le16(fp, 2);
+  write_le32(fp, OUT_RATE);
+  write_le32(fp, OUT_RATE * 4);
+  write_le16(fp, 4);
+  write_le16(fp, 16);
+  fwrite("data", 1, 4, fp);
+  write_le32(fp, data_bytes);
+}
+
+//
+//  host side control
+//
+void host_pcm8pp_open(const char* wav_file) {
+  if (wav_file == NULL) return;
+  g_wav_fp = fopen(wav_file, "wb");
+  if (g_wav_fp == NULL) {
+    printf("warn: wav output file create error. (%s)\n", wav_file);
+    return;
+  }
+  write_wav_header(g_wav_fp, 0);
+  g_wav_bytes = 0;
+}
+
+void host_pcm8pp_close(void) {
+  if (g_wav_fp == NULL) return;
+  fseek(g_wav_fp, 0, SEEK_SET);
+  write_wav_header(g_wav_fp, g_wav_bytes);
+  fclose(g_wav_fp);
+  g_wav_fp = NULL;
+}
+
+//
+//  mix the next output frame of all channels (host byte order)
+//
+static void mix_frame(int16_t* out_l, int16_t* out_r) {
+
+  int32_t l = 0;
+  int32_t r = 0;
+  int16_t playing = 0;
+
+  if (!g_paused) {
+    for (int16_t c = 0; c < MAX_CHANNELS; c++) {
+      HOST_CHANNEL* ch = &(g_channels[c]);
+      if (ch->remain == 0) continue;
+      ch->phase += (uint32_t)(((uint64_t)mode_rate(ch->mode) << 16) / OUT_RATE);
+      while (ch->phase >= 0x10000 && ch->remain > 0) {
+        fetch_sample(ch);
+        ch->phase -= 0x10000;
+      }
+      l += ch->l * mode_volume(ch->mode) / 8;
+      r += ch->r * mode_volume(ch->mode) / 8;
+      playing = 1;
+    }
+  }
+
+  if (playing) g_played_frames++;
+  g_out_frames++;
+
+  *out_l = l > 32767 ? 32767 : l < -32768 ? -32768 : l;
+  *out_r = r > 32767 ? 32767 : r < -32768 ? -32768 : r;
+}
+
+//
+//  let all channels play for the given time
+//
+void host_pcm8pp_advance(uint32_t usec) {
+
+  // output frames of this period, the remainder is carried to the next one
+  uint64_t t = (uint64_t)usec * OUT_RATE + g_frac_usec;
+  uint32_t frames = (uint32_t)(t / 1000000);
+  g_frac_usec = (uint32_t)(t % 1000000);
+
+  for (uint32_t i = 0; i < frames; i++) {
+    int16_t l, r;
+    mix_frame(&l, &r);
+    if (g_wav_fp != NULL) {
+      write_le16(g_wav_fp, (uint16_t)l);
+      write_le16(g_wav_fp, (uint16_t)r);
+      g_wav_bytes += 4;
+    }
+  }
+}
+
+//
+//  mix a number of output frames into a buffer instead of the wav file (host checks)
+//
+void host_pcm8pp_render(int16_t* buffer, uint32_t frames) {
+  for (uint32_t i = 0; i < frames; i++) {
+    mix_frame(&(buffer[ i * 2 + 0 ]), &(buffer[ i * 2 + 1 ]));
+  }
+}
+
+uint32_t host_pcm8pp_get_play_count(void) {
+  return g_play_count;
+}
+
+uint32_t host_pcm8pp_get_played_msec(void) {
+  return (uint32_t)(g_played_frames * 1000 / OUT_RATE);
+}
+
+void host_pcm8pp_report(void) {
+  uint32_t msec = host_pcm8pp_get_played_msec();
+  printf("pcm8pp: %d play calls, %d stop calls, played %d:%02d.%03d, idle %d [msec]\n",
+    g_play_count, g_stop_count, msec / 60000, msec / 1000 % 60, msec % 1000,
+    (uint32_t)((g_out_frames - g_played_frames) * 1000 / OUT_RATE));
+  if (g_wav_bytes > 0) {
+    printf("pcm8pp: wrote %d bytes of wav data\n", g_wav_bytes);
+  }
+}
+
+//
+//  PCM8PP API
+//
+int32_t pcm8pp_play(int16_t channel, uint32_t mode, uint32_t size, uint32_t freq, void* addr) {
+  if (channel < 0 || channel >= MAX_CHANNELS) return -1;
+  HOST_CHANNEL* ch = &(g_channels[ channel ]);
+  memset(ch, 0, sizeof(HOST_CHANNEL));
+  ch->mode = mode;
+  ch->addr = (uint8_t*)addr;
+  ch->remain = size;
+  ch->phase = 0x10000;      // fetch the first sample immediately
+  g_play_count++;
+  return 0;
+}
+
+int32_t pcm8pp_play_linked_array_chain(int16_t channel, uint32_t mode, uint32_t size, uint32_t freq, void* addr) {
+  if (channel < 0 || channel >= MAX_CHANNELS) return -1;
+  HOST_CHANNEL* ch = &(g_channels[ channel ]);
+  memset(ch, 0, sizeof(HOST_CHANNEL));
+  ch->mode = mode;
+  ch->link = (PCM8PP_LINK*)addr;
+  ch->addr = (uint8_t*)ch->link->addr;
+  ch->remain = ch->link->length;
+  ch->phase = 0x10000;
+  g_play_count++;
+  return 0;
+}
+
+int32_t pcm8pp_set_channel_mode(int16_t channel, uint32_t mode) {
+  if (channel < 0 || channel >= MAX_CHANNELS) return -1;
+  HOST_CHANNEL* ch = &(g_channels[ channel ]);
+  // $ff in a field keeps the current setting
+  for (int16_t shift = 0; shift <= 16; shift += 8) {
+    if (((mode >> shift) & 0xff) != 0xff) {
+      ch->mode = (ch->mode & ~(0xff << shift)) | (mode & (0xff << shift));
+    }
+  }
+  return 0;
+}
+
+int32_t pcm8pp_get_data_length(int16_t channel) {
+  if (channel < 0 || channel >= MAX_CHANNELS) return 0;
+  return g_channels[ channel ].remain;
+}
+
+int32_t pcm8pp_stop() {
+  for (int16_t c = 0; c < MAX_CHANNELS; c++) {
+    g_channels[c].remain = 0;
+    g_channels[c].link = NULL;
+  }
+  g_paused = 0;
+  g_stop_count++;
+  return 0;
+}
+
+int32_t pcm8pp_pause() {
+  g_paused = 1;
+  return 0;
+}
+
+int32_t pcm8pp_resume() {
+  g_paused = 0;
+  return 0;
+}
+
+int32_t pcm8pp_keepchk() {
+  return 1;
+}
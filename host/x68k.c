@@ -0,0 +1,394 @@
+//
+//  Human68k DOS/IOCS calls on Linux and the simulation loop driven by virtual timer-B
+//
+//  The resident part of s44bgp runs inside KEEPPR(): the loop advances the virtual clock by
+//  the programmed timer period, lets the virtual PCM8PP consume the buffers and then calls
+//  the registered interrupt handler, exactly as OPM timer-B would do on the real machine.
+//
+//  environment variables
+//    S44SIM_WAV=<file>     write the virtual PCM8PP output as 44.1kHz 16bit stereo wav
+//    S44SIM_TIME=<msec>    virtual time limit (default: 3600000)
+//    S44SIM_TRACKS=<n>     stop after n tracks were played to the end or skipped (default: 1)
+//    S44SIM_SPEED=<n>      0: as fast as possible (default), n: n times faster than real time
+//    S44SIM_MPU=<n>        MPU type at $0CBC (0: 68000 default, 3: 68030, 6: 68060)
+//    S44SIM_EVENTS=<list>  comma separated <msec>:<event>, event is one of
+//                          pause (CTRL+XF4), skip (CTRL+XF5), stop (external PCM8PP stop),
+//                          steal (external PCM8PP stop and 1sec of silence played on channel 1)
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <limits.h>
+#include "doslib.h"
+#include "iocslib.h"
+#include "pcm8pp.h"
+#include "resident.h"
+#include "host.h"
+
+#define MAX_EVENTS (64)
+
+#define EVENT_PAUSE (1)
+#define EVENT_SKIP  (2)
+#define EVENT_STOP  (3)
+#define EVENT_STEAL (4)
+
+typedef struct {
+  uint32_t msec;
+  int16_t type;
+} SIM_EVENT;
+
+// process memory addresses (only meaningful on the real machine, the resident size shows 0)
+uint32_t _PSP = 0;
+uint32_t _resident_end = 0xf0;
+
+// dummy memory block whose parent and child links are empty, so no keep process is found
+static uint8_t g_memory_block[ 256 ];
+static void* g_current_pdb;
+static uint16_t g_indos_flag;
+
+// virtual timer
+static void (*g_timer_handler)(void);
+static uint32_t g_timer_period_usec;
+static uint8_t g_opm_regs[ 256 ];
+static uint64_t g_sim_time_usec;
+
+// virtual keyboard
+static int32_t g_shift_state;
+static int32_t g_bitsns_0b;
+static uint64_t g_key_release_usec;
+static void (*g_key_vector)(void);
+
+//
+//  DOS _OPEN/_READ/_SEEK/_CLOSE (drive names given by _NAMECK are ignored)
+//
+int32_t OPEN(const uint8_t* file_name, int32_t mode) {
+  if (file_name[0] != '\0' && file_name[1] == ':') file_name += 2;
+  int32_t fd = open((const char*)file_name, mode == 0 ? O_RDONLY : O_RDWR);
+  return fd < 0 ? -2 : fd;
+}
+
+int32_t READ(int32_t fd, void* buffer, int32_t bytes) {
+  ssize_t n = read(fd, buffer, bytes);
+  return n < 0 ? -1 : (int32_t)n;
+}
+
+int32_t SEEK(int32_t fd, int32_t ofs, int32_t mode) {
+  off_t n = lseek(fd, ofs, mode == 0 ? SEEK_SET : mode == 1 ? SEEK_CUR : SEEK_END);
+  return n < 0 ? -25 : (int32_t)n;
+}
+
+int32_t CLOSE(int32_t fd) {
+  return close(fd);
+}
+
+//
+//  DOS _FILES (single file lookup, DOS date and time from the modification time)
+//
+int32_t FILES(struct FILBUF* filbuf, const uint8_t* file_name, int32_t atr) {
+  struct stat st;
+  if (stat((const char*)file_name, &st) != 0 || !S_ISREG(st.st_mode)) return -2;
+  struct tm* tm = localtime(&st.st_mtime);
+  filbuf->atr = 0x20;
+  filbuf->time = (uint16_t)((tm->tm_hour << 11) | (tm->tm_min << 5) | (tm->tm_sec / 2));
+  filbuf->date = (uint16_t)(((tm->tm_year - 80) << 9) | ((tm->tm_mon + 1) << 5) | tm->tm_mday);
+  filbuf->filelen = (uint32_t)st.st_size;
+  const char* base = strrchr((const char*)file_name, '/');
+  strncpy((char*)filbuf->name, base != NULL ? base + 1 : (const char*)file_name, 22);
+  filbuf->name[22] = '\0';
+  return 0;
+}
+
+//
+//  DOS _NAMECK (absolute path of the host file system on a dummy drive)
+//
+int32_t NAMECK(const uint8_t* file_name, struct NAMECKBUF* nameck) {
+  char full_path[ PATH_MAX ];
+  if (realpath((const char*)file_name, full_path) == NULL) return -2;
+  char* base = strrchr(full_path, '/') + 1;
+  char* ext = strrchr(base, '.');
+  if ((size_t)(base - full_path) >= sizeof(nameck->path)) return -13;
+  memcpy(nameck->drive, "A:", 2);
+  memcpy(nameck->path, full_path, base - full_path);
+  nameck->path[ base - full_path ] = '\0';
+  if (ext == NULL) ext = base + strlen(base);
+  snprintf((char*)nameck->name, sizeof(nameck->name), "%.*s", (int)(ext - base), base);
+  snprintf((char*)nameck->ext, sizeof(nameck->ext), "%s", ext);
+  return 0;
+}
+
+//
+//  DOS _GETPDB/_SETPDB/_INDOSFLG/_MFREE/_KEEPPR, IOCS _B_LPEEK/_B_BPEEK
+//
+void* GETPDB(void) {
+  return g_current_pdb != NULL ? g_current_pdb : g_memory_block + 16;
+}
+
+void* SETPDB(void* pdb) {
+  void* old_pdb = GETPDB();
+  g_current_pdb = pdb;
+  return old_pdb;
+}
+
+void* INDOSFLG(void) {
+  // the resident part runs only between DOS calls of the simulation loop
+  return &g_indos_flag;
+}
+
+int32_t MFREE(uint32_t addr) {
+  return 0;
+}
+
+uint32_t B_LPEEK(const void* addr) {
+  // exception vectors and the IOCS call table (no IOCS handlers in the simulation)
+  if ((uintptr_t)addr < 0x800) return 0;
+  const uint8_t* p = (const uint8_t*)addr;
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+uint8_t B_BPEEK(const void* addr) {
+  // MFP timer-C data register counts down 200 to 0 every 10msec (follows the wall clock)
+  if ((uintptr_t)addr == 0xE88023) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint8_t)(200 - tv.tv_usec % 10000 / 50);
+  }
+  // MFP interrupt pending register B (the timer-C tick is counted by ONTIME as soon as it expires)
+  if ((uintptr_t)addr == 0xE8800D) {
+    return 0;
+  }
+  // MPU type in the IOCS work area
+  if ((uintptr_t)addr == 0x0cbc) {
+    const char* env_mpu = getenv("S44SIM_MPU");
+    return env_mpu != NULL ? (uint8_t)atoi(env_mpu) : 0;
+  }
+  return *(const uint8_t*)addr;
+}
+
+int32_t C_FNKMOD(int32_t mode) {
+  return 0;
+}
+
+//
+//  DOS _INTVCS (only the keyboard vector $4c is kept, its handler is called for every virtual key change)
+//
+void* INTVCS(int32_t vector, void* handler) {
+  void* old = NULL;
+  if (vector == 0x4c) {
+    old = (void*)g_key_vector;
+    g_key_vector = (void (*)(void))handler;
+  }
+  return old;
+}
+
+//
+//  IOCS _ONTIME (1/100 sec since power on, wrapped per day, whole seconds counted from the first call
+//  so that the ticks stay in step with the timer-C register above)
+//
+int32_t ONTIME(void) {
+  static time_t power_on = 0;
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  if (power_on == 0) power_on = tv.tv_sec;
+  return (int32_t)(((tv.tv_sec - power_on) % 86400) * 100 + tv.tv_usec / 10000);
+}
+
+//
+//  DOS _GETTIM2 (wall clock, hour << 16 | minute << 8 | second)
+//
+int32_t GETTIM2(void) {
+  time_t t = time(NULL);
+  struct tm* tm = localtime(&t);
+  return (tm->tm_hour << 16) | (tm->tm_min << 8) | tm->tm_sec;
+}
+
+//
+//  IOCS _B_SFTSNS/_BITSNS (keys are pressed only by S44SIM_EVENTS)
+//
+int32_t B_SFTSNS(void) {
+  return g_shift_state;
+}
+
+int32_t BITSNS(int32_t group) {
+  return group == 0x0b ? g_bitsns_0b : 0;
+}
+
+//
+//  IOCS _B_PUTMES (logged with the virtual time)
+//
+int32_t B_PUTMES(int32_t color, int32_t x, int32_t y, int32_t len, const void* message) {
+  uint32_t msec = host_get_sim_time();
+  printf("[%3d:%02d.%03d] x=%2d %.*s\n", msec / 60000, msec / 1000 % 60, msec % 1000, x, len, (const char*)message);
+  return 0;
+}
+
+//
+//  IOCS _OPMSNS/_OPMSET/_OPMINTST/_TIMERDST
+//
+int32_t OPMSNS(void) {
+  return 0;
+}
+
+int32_t OPMSET(int32_t reg, int32_t data) {
+  g_opm_regs[ reg & 0xff ] = (uint8_t)data;
+  if ((reg & 0xff) == 0x12) {
+    // Tb(ms) = 1024 * (256 - CLKB) / 4000
+    g_timer_period_usec = 256 * (256 - (data & 0xff));
+  }
+  return 0;
+}
+
+int32_t OPMINTST(void* handler) {
+  if (handler != NULL && g_timer_handler != NULL) return 1;
+  g_timer_handler = (void (*)(void))handler;
+  return 0;
+}
+
+int32_t TIMERDST(void* handler, int32_t mode, int32_t count) {
+  // MFP prescaler in 1/4 usec
+  static const int32_t prescale[] = { 0, 4, 10, 16, 50, 64, 100, 200 };
+  if (handler != NULL && g_timer_handler != NULL) return 1;
+  g_timer_handler = (void (*)(void))handler;
+  g_timer_period_usec = prescale[ mode & 0x07 ] * count / 4;
+  g_opm_regs[ 0x14 ] = handler != NULL ? 0x08 : 0x00;    // treated as an enabled timer
+  return 0;
+}
+
+//
+//  virtual time in msec since the resident part started
+//
+uint32_t host_get_sim_time(void) {
+  return (uint32_t)(g_sim_time_usec / 1000);
+}
+
+//
+//  parse S44SIM_EVENTS
+//
+static int16_t parse_events(const char* list, SIM_EVENT* events) {
+  int16_t num_events = 0;
+  const char* p = list;
+  while (p != NULL && *p != '\0' && num_events < MAX_EVENTS) {
+    uint32_t msec = strtoul(p, (char**)&p, 10);
+    if (*p != ':') break;
+    p++;
+    int16_t type = strncmp(p, "pause", 5) == 0 ? EVENT_PAUSE :
+                   strncmp(p, "skip", 4) == 0 ? EVENT_SKIP :
+                   strncmp(p, "stop", 4) == 0 ? EVENT_STOP :
+                   strncmp(p, "steal", 5) == 0 ? EVENT_STEAL : 0;
+    if (type == 0) {
+      printf("warn: unknown simulation event. (%s)\n", p);
+      break;
+    }
+    events[ num_events ].msec = msec;
+    events[ num_events ].type = type;
+    num_events++;
+    p = strchr(p, ',');
+    if (p != NULL) p++;
+  }
+  return num_events;
+}
+
+//
+//  run the resident part until the time or track limit
+//
+static void run_simulation(void) {
+
+  const char* env_wav = getenv("S44SIM_WAV");
+  const char* env_time = getenv("S44SIM_TIME");
+  const char* env_tracks = getenv("S44SIM_TRACKS");
+  const char* env_speed = getenv("S44SIM_SPEED");
+  const char* env_events = getenv("S44SIM_EVENTS");
+
+  uint32_t time_limit = env_time != NULL ? strtoul(env_time, NULL, 10) : 3600000;
+  uint32_t track_limit = env_tracks != NULL ? strtoul(env_tracks, NULL, 10) : 1;
+  uint32_t speed = env_speed != NULL ? strtoul(env_speed, NULL, 10) : 0;
+
+  static SIM_EVENT events[ MAX_EVENTS ];
+  int16_t num_events = parse_events(env_events, events);
+  int16_t next_event = 0;
+
+  if (g_timer_handler == NULL || g_timer_period_usec == 0) {
+    printf("error: no timer interrupt handler is registered.\n");
+    return;
+  }
+
+  host_pcm8pp_open(env_wav);
+
+  struct timeval tv0;
+  gettimeofday(&tv0, NULL);
+
+  while (g_sim_time_usec < (uint64_t)time_limit * 1000) {
+
+    // pcm8pp keeps playing until the next interrupt
+    host_pcm8pp_advance(g_timer_period_usec);
+    g_sim_time_usec += g_timer_period_usec;
+
+    // key release and scripted events, keys are held for 2 interrupts so that every check sees them once
+    if (g_key_release_usec != 0 && g_sim_time_usec >= g_key_release_usec) {
+      g_shift_state = 0;
+      g_bitsns_0b = 0;
+      g_key_release_usec = 0;
+      if (g_key_vector != NULL) g_key_vector();
+    }
+    while (next_event < num_events && events[ next_event ].msec <= host_get_sim_time()) {
+      SIM_EVENT* e = &(events[ next_event++ ]);
+      if (e->type == EVENT_STOP) {
+        pcm8pp_stop();
+      } else if (e->type == EVENT_STEAL) {
+        static uint8_t silence[ 44100 * 4 ];
+        pcm8pp_stop();
+        pcm8pp_play(1, (8 << 16) | (0x1d << 8) | 0x03, sizeof(silence), 44100*256, silence);
+      } else {
+        g_shift_state = 0x02;
+        g_bitsns_0b = e->type == EVENT_PAUSE ? 0x01 : 0x02;
+        g_key_release_usec = g_sim_time_usec + g_timer_period_usec * 2;
+        if (g_key_vector != NULL) g_key_vector();
+      }
+    }
+
+    // timer-B interrupt (register $14 bit3: timer-B interrupt enable)
+    if (g_opm_regs[ 0x14 ] & 0x08) {
+      g_timer_handler();
+    }
+
+    // the first play is the initial one
+    if (host_pcm8pp_get_play_count() > track_limit) break;
+
+    if (speed > 0) {
+      struct timeval tv1;
+      gettimeofday(&tv1, NULL);
+      int64_t real_usec = (int64_t)(tv1.tv_sec - tv0.tv_sec) * 1000000 + (tv1.tv_usec - tv0.tv_usec);
+      int64_t wait_usec = (int64_t)(g_sim_time_usec / speed) - real_usec;
+      if (wait_usec > 0) usleep(wait_usec);
+    }
+  }
+
+  host_pcm8pp_close();
+
+  uint32_t msec = host_get_sim_time();
+  printf("--\n");
+  printf("simulated time: %d:%02d.%03d (timer period %d.%03d ms)\n",
+    msec / 60000, msec / 1000 % 60, msec % 1000, g_timer_period_usec / 1000, g_timer_period_usec % 1000);
+  host_pcm8pp_report();
+  host_himem_report();
+
+  // disk reads of the resident part (as -stat shows them)
+  if (g_resident.state != NULL) {
+    REFILL* rf = &(g_resident.state->refill);
+    printf("disk reads: %d reads, %d opens, %d seeks, %d deferred, underruns %d (stream) / %d (track cache)\n",
+      rf->reads, rf->opens, rf->seeks, rf->deferred, g_resident.state->stream.underruns, g_resident.state->track_cache.underruns);
+  }
+}
+
+//
+//  DOS _KEEPPR never returns, the host build runs the resident part here and exits
+//
+void KEEPPR(uint32_t size, int32_t rc) {
+  run_simulation();
+  exit(rc);
+}
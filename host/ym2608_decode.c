@@ -0,0 +1,150 @@
+//
+//  ADPCM(YM2608) decoder for the host simulation build
+//
+//  C version of atop_exec in ym2608_adpcmlib.s (same step table, index range and nibble order),
+//  used in place of ../src/ym2608_decode.c which calls the 68000 routines.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "himem.h"
+#include "profile.h"
+#include "sample.h"
+#include "ym2608_decode.h"
+
+#define MAX_STEP_INDEX (68)
+
+static const int16_t step_table[] = {
+     16,   17,   19,   21,   23,   25,   28,   31,   34,   37,   41,   45,   50,   55,   60,   66,
+     73,   80,   88,   97,  107,  118,  130,  143,  157,  173,  190,  209,  230,  253,  279,  307,
+    337,  371,  408,  449,  494,  544,  598,  658,  724,  796,  875,  963, 1060, 1166, 1282, 1411,
+   1552, 1707, 1877, 2065, 2272, 2499, 2749, 3023, 3325, 3657, 4022, 4424, 4866, 5352, 5887, 6475,
+   7122, 7834, 8617, 9478, 10425,
+};
+
+static const int16_t index_shift[] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// decoder state in the work area of the handle (the 68000 version keeps its own layout there)
+typedef struct {
+  int16_t stereo;
+  int16_t value[2];
+  int16_t step_index[2];
+} DECODE_WORK;
+
+_Static_assert(sizeof(DECODE_WORK) <= ADPCMLIB_WORK_SIZE, "DECODE_WORK does not fit in the work area of the handle");
+
+//
+//  decode one 4bit code
+//
+static int16_t decode_nibble(DECODE_WORK* w, int16_t ch, uint8_t code) {
+  int32_t diff = (int32_t)step_table[ w->step_index[ch] ] * ((code & 7) * 2 + 1) >> 3;
+  w->value[ch] += (code & 8) ? -diff : diff;
+  int16_t step_index = w->step_index[ch] + index_shift[ code & 7 ];
+  w->step_index[ch] = step_index < 0 ? 0 : step_index > MAX_STEP_INDEX ? MAX_STEP_INDEX : step_index;
+  return w->value[ch];
+}
+
+int32_t ym2608_decode_init(YM2608_DECODE_HANDLE* nas, size_t decode_buffer_len, int32_t sample_rate, int16_t channels) {
+
+  int32_t rc = -1;
+
+  // baseline
+  nas->decode_buffer = NULL;
+  nas->decode_buffer_len = decode_buffer_len;
+  nas->decode_buffer_ofs = 0;
+  nas->sample_rate = sample_rate;
+  nas->channels = channels;
+  nas->resample_counter = 0;
+  nas->conv_table = NULL;
+  nas->decode_time = 0;
+  nas->decode_bytes = 0;
+
+  // buffer allocation
+  nas->decode_buffer = himem_malloc(nas->decode_buffer_len * sizeof(int16_t), 0);
+  if (nas->decode_buffer == NULL) goto exit;
+
+  // conversion table is not used, but allocated to keep the memory footprint the same
+  nas->conv_table = himem_malloc(ADPCMLIB_CONV_TABLE_SIZE, 0);
+  if (nas->conv_table == NULL) goto exit;
+
+  ym2608_decode_reset(nas);
+
+  rc = 0;
+
+exit:
+  return rc;
+}
+
+void ym2608_decode_close(YM2608_DECODE_HANDLE* nas) {
+  if (nas->decode_buffer != NULL) {
+    himem_free(nas->decode_buffer, 0);
+    nas->decode_buffer = NULL;
+  }
+  if (nas->conv_table != NULL) {
+    himem_free(nas->conv_table, 0);
+    nas->conv_table = NULL;
+  }
+}
+
+void ym2608_decode_reset(YM2608_DECODE_HANDLE* nas) {
+  DECODE_WORK* w = (DECODE_WORK*)nas->work_area;
+  memset(w, 0, sizeof(DECODE_WORK));
+  w->stereo = nas->channels == 1 ? 0 : 1;
+}
+
+void ym2608_decode_save(YM2608_DECODE_HANDLE* nas, YM2608_DECODE_STATE* state) {
+  DECODE_WORK* w = (DECODE_WORK*)nas->work_area;
+  for (int16_t ch = 0; ch < 2; ch++) {
+    state->value[ch] = w->value[ch];
+    state->step[ch] = w->step_index[ch];
+  }
+}
+
+void ym2608_decode_restore(YM2608_DECODE_HANDLE* nas, const YM2608_DECODE_STATE* state) {
+  DECODE_WORK* w = (DECODE_WORK*)nas->work_area;
+  for (int16_t ch = 0; ch < 2; ch++) {
+    w->value[ch] = state->value[ch];
+    w->step_index[ch] = state->step[ch];
+  }
+}
+
+size_t ym2608_decode_exec_buffer(YM2608_DECODE_HANDLE* nas, uint8_t* adpcm_data, size_t adpcm_data_bytes, int16_t* decode_buffer, size_t decode_buffer_len, size_t* used_bytes) {
+
+  DECODE_WORK* w = (DECODE_WORK*)nas->work_area;
+
+  // partial output when the decode buffer is short
+  size_t bytes = decode_buffer_len * sizeof(int16_t) / 4;
+  if (bytes > adpcm_data_bytes) bytes = adpcm_data_bytes;
+  if (w->stereo) bytes &= ~0x01;
+  if (used_bytes != NULL) *used_bytes = bytes;
+
+  // big endian samples as the 68000 version writes them
+  int16_t* d = decode_buffer;
+  if (w->stereo) {
+    // 2 bytes (ch0, ch1) give 2 stereo frames, upper nibbles first
+    for (size_t i = 0; i + 1 < bytes; i += 2) {
+      uint8_t c0 = adpcm_data[i];
+      uint8_t c1 = adpcm_data[i + 1];
+      *d++ = SAMPLE(decode_nibble(w, 0, c0 >> 4));
+      *d++ = SAMPLE(decode_nibble(w, 1, c1 >> 4));
+      *d++ = SAMPLE(decode_nibble(w, 0, c0 & 0x0f));
+      *d++ = SAMPLE(decode_nibble(w, 1, c1 & 0x0f));
+    }
+  } else {
+    for (size_t i = 0; i < bytes; i++) {
+      *d++ = SAMPLE(decode_nibble(w, 0, adpcm_data[i] >> 4));
+      *d++ = SAMPLE(decode_nibble(w, 0, adpcm_data[i] & 0x0f));
+    }
+  }
+
+  return bytes * 4 / sizeof(int16_t);
+}
+
+size_t ym2608_decode_exec(YM2608_DECODE_HANDLE* nas, uint8_t* adpcm_data, size_t adpcm_data_bytes) {
+  uint32_t t0 = profile_get_usec();
+  nas->decode_buffer_ofs =
+    ym2608_decode_exec_buffer(nas, adpcm_data, adpcm_data_bytes, nas->decode_buffer, nas->decode_buffer_len, NULL);
+  nas->decode_time += profile_get_usec() - t0;
+  nas->decode_bytes += nas->decode_buffer_ofs * sizeof(int16_t);
+  return nas->decode_buffer_ofs;
+}
@@ -0,0 +1,56 @@
+#!/bin/bash
+#
+#  kernel benchmark of the target build under run68
+#
+#  ./bench-run68.sh [output file]  (default: _build/bench-run68.tsv, S44BGP.X is built first when it is missing)
+#
+#  run68 runs the 68000 code of S44BGP.X but has no cycle model, so its KB/s only compares kernels with each other.
+#  The estimate lines are not measured: they are counted by hand from the 68000 timing tables (no wait states, no
+#  DMA or refresh cycles) for the inner loops of atop_exec (conv_mono/conv_stereo in ym2608_adpcmlib.s), and they
+#  are only a fixed reference for the measured numbers, an upper bound of the real machine.
+#  Lines are tab separated like those of ../host/bench.sh:
+#    kernel    <kernel> <mode> <KB/s> <ratio to reference> <result>
+#    decoder   <layout> <KB/s> <samples/s> <measured time per byte in 10MHz clocks, host speed under run68>
+#    estimate  <routine> <layout> <instructions per byte> <cycles per byte> <KB/s at 10MHz> hand-counted
+#
+
+if [ "${XDEV68K_DIR}" == "" ]; then
+  echo "error: XDEV68K_DIR environment variable is not defined."
+  exit 1
+fi
+
+RUN68=${XDEV68K_DIR}/run68/run68
+TARGET_FILE=_build/S44BGP.X
+OUT_FILE=${1:-_build/bench-run68.tsv}
+
+#
+#  68000 cycles of the atop_exec loops, estimated by hand ($1: layout, $2: instructions, $3: cycles, $4: ADPCM bytes per iteration)
+#    conv_mono   move.w 4, move.b (a1)+ 8, lsl.w #3 12, adda.w 8, 2 x (add.w (a0)+ 8, move.w (a2)+ 8),
+#                adda.l (a0) 14, subq.l 8, bcc taken 10
+#    conv_stereo the address part and adda.l twice, 4 x add/move, subq.l #2 and bcc once per byte pair
+#
+function atop_cycles() {
+  awk -v layout="$1" -v insns="$2" -v cycles="$3" -v bytes="$4" 'BEGIN {
+    printf("estimate\tatop_exec\t%s\t%.1f\t%.1f\t%d\thand-counted\n", layout, insns / bytes, cycles / bytes, 10000000 / (cycles / bytes) / 1024)
+  }'
+}
+
+function run_bench() {
+  if [ ! -f ${TARGET_FILE} ]; then
+    ./make-xdev68k.sh || return 1
+  fi
+  echo -e "# s44bgp run68 kernel benchmark\t`ls -l ${TARGET_FILE} | awk '{ print $5 }'` bytes" > ${OUT_FILE}
+  ${RUN68} ${TARGET_FILE} -bench | awk '
+    $NF == "ok" || $NF == "MISMATCH" || $NF == "skipped" { printf("kernel\t%s\t%s\t%s\t%s\t%s\n", $1, $2, $3, $4, $5) }
+    $1 == "decoder" && $3 ~ /^[0-9]+$/ { printf("decoder\t%s\t%s\t%s\t%s\n", $2, $3, $4, $5) }' >> ${OUT_FILE}
+  if ! grep -q "^decoder" ${OUT_FILE}; then
+    echo "error: no benchmark output from run68."
+    return 1
+  fi
+  atop_cycles mono 11 96 1 >> ${OUT_FILE}
+  atop_cycles stereo 22 174 2 >> ${OUT_FILE}
+  echo "wrote ${OUT_FILE} (the estimate lines are hand-counted cycles, not run68 measurements)"
+  return 0
+}
+
+run_bench || exit 1
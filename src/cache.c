@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "himem.h"
+#include "dosio.h"
+#include "cache.h"
+
+//
+//  open metadata cache (a missing or incompatible cache file gives an empty cache)
+//
+int32_t cache_open(CACHE_HANDLE* cache, const uint8_t* cache_file_name) {
+
+  // default return code
+  int32_t rc = -1;
+  FILE* fp = NULL;
+
+  // reset attributes
+  if (cache == NULL) goto exit;
+  cache->num_entries = 0;
+  cache->updated = 0;
+  cache->entries = himem_malloc(sizeof(CACHE_ENTRY) * MAX_MUSIC, 0);
+  if (cache->entries == NULL) goto exit;
+
+  rc = 0;
+
+  // header check (eye catch, version, entry size, number of entries)
+  fp = fopen(cache_file_name, "rb");
+  if (fp == NULL) goto exit;
+  uint8_t header[ 10 ];
+  if (fread(header, 1, 10, fp) != 10) goto exit;
+  if (memcmp(header, CACHE_EYE_CATCH, 4) != 0) goto exit;
+  if (((header[4] << 8) | header[5]) != CACHE_VERSION) goto exit;
+  if (((header[6] << 8) | header[7]) != sizeof(CACHE_ENTRY)) goto exit;
+  // a bad count drops the whole cache
+  uint16_t num_entries = (header[8] << 8) | header[9];
+  if (num_entries > MAX_MUSIC) goto exit;
+
+  if (fread(cache->entries, sizeof(CACHE_ENTRY), num_entries, fp) != num_entries) goto exit;
+  cache->num_entries = num_entries;
+
+exit:
+  if (fp != NULL) fclose(fp);
+  return rc;
+}
+
+//
+//  close metadata cache
+//
+void cache_close(CACHE_HANDLE* cache) {
+  if (cache->entries != NULL) {
+    himem_free(cache->entries, 0);
+    cache->entries = NULL;
+  }
+  cache->num_entries = 0;
+}
+
+//
+//  save metadata cache if updated
+//
+int32_t cache_save(CACHE_HANDLE* cache, const uint8_t* cache_file_name) {
+
+  // default return code
+  int32_t rc = -1;
+  FILE* fp = NULL;
+
+  if (cache->entries == NULL) goto exit;
+  if (!cache->updated) {
+    rc = 0;
+    goto exit;
+  }
+
+  fp = fopen(cache_file_name, "wb");
+  if (fp == NULL) goto exit;
+
+  uint8_t header[ 10 ];
+  memcpy(header, CACHE_EYE_CATCH, 4);
+  header[4] = CACHE_VERSION >> 8;
+  header[5] = CACHE_VERSION & 0xff;
+  header[6] = sizeof(CACHE_ENTRY) >> 8;
+  header[7] = sizeof(CACHE_ENTRY) & 0xff;
+  header[8] = cache->num_entries >> 8;
+  header[9] = cache->num_entries & 0xff;
+  if (fwrite(header, 1, 10, fp) != 10) goto exit;
+  if (fwrite(cache->entries, sizeof(CACHE_ENTRY), cache->num_entries, fp) != cache->num_entries) goto exit;
+
+  cache->updated = 0;
+  rc = 0;
+
+exit:
+  if (fp != NULL) fclose(fp);
+  return rc;
+}
+
+//
+//  KMD file name of a PCM file
+//
+static void get_kmd_name(uint8_t* kmd_name, const uint8_t* file_name) {
+  strcpy(kmd_name, file_name);
+  strcpy(kmd_name + strlen(kmd_name) - 4, ".kmd");
+}
+
+//
+//  find a valid entry (the size and timestamp of the file and of its KMD file are checked with a directory lookup each)
+//
+CACHE_ENTRY* cache_lookup(CACHE_HANDLE* cache, const uint8_t* file_name, uint16_t conv_mode) {
+
+  if (cache->entries == NULL) return NULL;
+
+  for (int16_t i = 0; i < cache->num_entries; i++) {
+    CACHE_ENTRY* e = &(cache->entries[i]);
+    if (e->conv_mode == conv_mode && stricmp(e->file_name, file_name) == 0) {
+      uint32_t file_bytes, file_time;
+      if (dosio_stat(file_name, &file_bytes, &file_time) != 0) return NULL;
+      if (e->file_bytes != file_bytes || e->file_time != file_time) return NULL;
+      static uint8_t kmd_name[ MAX_PATH_LEN ];
+      uint32_t kmd_bytes = 0, kmd_time = 0;
+      get_kmd_name(kmd_name, file_name);
+      int16_t kmd = dosio_stat(kmd_name, &kmd_bytes, &kmd_time) == 0;
+      if (kmd != (e->kmd_events >= 0) || e->kmd_bytes != kmd_bytes || e->kmd_time != kmd_time) return NULL;
+      return e;
+    }
+  }
+
+  return NULL;
+}
+
+//
+//  add or replace an entry, the cache is marked for saving only when the entry is new or differs
+//  (the sizes and timestamps are filled in here unless valid is set, then they are those of a valid entry of cache_lookup)
+//
+int32_t cache_update(CACHE_HANDLE* cache, CACHE_ENTRY* entry, const CACHE_ENTRY* valid) {
+
+  if (cache->entries == NULL) return -1;
+
+  if (valid != NULL) {
+    entry->file_bytes = valid->file_bytes;
+    entry->file_time = valid->file_time;
+    entry->kmd_bytes = valid->kmd_bytes;
+    entry->kmd_time = valid->kmd_time;
+  } else {
+    if (dosio_stat(entry->file_name, &(entry->file_bytes), &(entry->file_time)) != 0) return -1;
+    static uint8_t kmd_name[ MAX_PATH_LEN ];
+    get_kmd_name(kmd_name, entry->file_name);
+    entry->kmd_bytes = 0;
+    entry->kmd_time = 0;
+    if (entry->kmd_events >= 0 && dosio_stat(kmd_name, &(entry->kmd_bytes), &(entry->kmd_time)) != 0) return -1;
+  }
+
+  int16_t i;
+  for (i = 0; i < cache->num_entries; i++) {
+    CACHE_ENTRY* e = &(cache->entries[i]);
+    if (e->conv_mode == entry->conv_mode && stricmp(e->file_name, entry->file_name) == 0) break;
+  }
+  if (i >= MAX_MUSIC) return -1;
+  if (i < cache->num_entries && memcmp(&(cache->entries[i]), entry, sizeof(CACHE_ENTRY)) == 0) return 0;
+  if (i == cache->num_entries) cache->num_entries++;
+
+  memcpy(&(cache->entries[i]), entry, sizeof(CACHE_ENTRY));
+  cache->updated = 1;
+
+  return 0;
+}
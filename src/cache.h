@@ -0,0 +1,54 @@
+#ifndef __H_CACHE__
+#define __H_CACHE__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "kmd.h"
+#include "s44bgp.h"
+
+#define CACHE_EYE_CATCH "S44C"
+#define CACHE_VERSION   (2)
+
+// conversion mode bits
+#define CACHE_MODE_MONO      (0x01)
+#define CACHE_MODE_HALF_RATE (0x02)
+#define CACHE_MODE_HALF_BIT  (0x04)
+#define CACHE_MODE_ADPCM     (0x08)
+
+// source formats
+#define CACHE_FORMAT_S44 (1)
+#define CACHE_FORMAT_A44 (2)
+#define CACHE_FORMAT_Z44 (3)
+#define CACHE_FORMAT_WAV (4)
+
+typedef struct {
+  uint8_t file_name[ MAX_PATH_LEN ];
+  uint32_t file_bytes;
+  uint32_t file_time;           // DOS date << 16 | time
+  uint16_t conv_mode;
+  uint16_t format;
+  uint32_t sample_rate;
+  uint32_t buffer_bytes;
+  uint32_t total_time_msec;
+  uint8_t tag_title[ KMD_MAX_MESSAGE_LEN + 1 ];
+  uint8_t tag_artist[ KMD_MAX_MESSAGE_LEN + 1 ];
+  uint8_t tag_album[ KMD_MAX_MESSAGE_LEN + 1 ];
+  int16_t kmd_events;           // -1: no KMD file, 0: tags only (the KMD parse is skipped)
+  uint32_t kmd_bytes;           // size and timestamp of the KMD file, checked as those of the PCM file
+  uint32_t kmd_time;
+} CACHE_ENTRY;
+
+typedef struct {
+  int16_t num_entries;
+  int16_t updated;
+  CACHE_ENTRY* entries;
+} CACHE_HANDLE;
+
+int32_t cache_open(CACHE_HANDLE* cache, const uint8_t* cache_file_name);
+void cache_close(CACHE_HANDLE* cache);
+int32_t cache_save(CACHE_HANDLE* cache, const uint8_t* cache_file_name);
+CACHE_ENTRY* cache_lookup(CACHE_HANDLE* cache, const uint8_t* file_name, uint16_t conv_mode);
+int32_t cache_update(CACHE_HANDLE* cache, CACHE_ENTRY* entry, const CACHE_ENTRY* valid);
+
+#endif
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <iocslib.h>
+#include "himem.h"
+#include "profile.h"
+#include "sample.h"
+#include "convert.h"
+
+#define BENCH_FRAMES (16384)
+#define BENCH_USEC   (200000)
+
+// most specific variant first
+static CONVERT_KERNEL* g_kernels[] = {
+  &convert_kernel_68060,
+  &convert_kernel_68020,
+  &convert_kernel_68000,
+};
+
+#define NUM_KERNELS (sizeof(g_kernels) / sizeof(g_kernels[0]))
+
+//
+//  portable per-sample reference of the kernels (defines the results, used by the benchmark)
+//  (samples are big endian in memory as PCM8PP plays them, see sample.h)
+//
+static size_t reference_to_16bit(int16_t* dst, const int16_t* src, size_t frames, int16_t mode, uint32_t* frame_count) {
+  int16_t* d = dst;
+  for (size_t j = 0; j < frames; j++) {
+    (*frame_count)++;
+    if ((mode & CONVERT_HALF_RATE) && !(*frame_count & 0x01)) continue;
+    if (mode & CONVERT_MONO) {
+      *d++ = SAMPLE((int16_t)(((int32_t)SAMPLE(src[ j * 2 + 0 ]) + SAMPLE(src[ j * 2 + 1 ])) >> 1));
+    } else {
+      d[0] = src[ j * 2 + 0 ];
+      d[1] = src[ j * 2 + 1 ];
+      d += 2;
+    }
+  }
+  return d - dst;
+}
+
+static size_t reference_to_8bit(int8_t* dst, const int16_t* src, size_t frames, int16_t mode, uint32_t* frame_count) {
+  int8_t* d = dst;
+  for (size_t j = 0; j < frames; j++) {
+    (*frame_count)++;
+    if ((mode & CONVERT_HALF_RATE) && !(*frame_count & 0x01)) continue;
+    if (mode & CONVERT_MONO) {
+      *d++ = (int8_t)(((int32_t)SAMPLE(src[ j * 2 + 0 ]) + SAMPLE(src[ j * 2 + 1 ])) >> 9);
+    } else {
+      d[0] = (int8_t)(SAMPLE(src[ j * 2 + 0 ]) >> 8);
+      d[1] = (int8_t)(SAMPLE(src[ j * 2 + 1 ]) >> 8);
+      d += 2;
+    }
+  }
+  return d - dst;
+}
+
+static void reference_swap_words(int16_t* dst, const int16_t* src, size_t len) {
+  const uint8_t* s = (const uint8_t*)src;
+  uint8_t* d = (uint8_t*)dst;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t lo = s[ i * 2 + 0 ];
+    d[ i * 2 + 0 ] = s[ i * 2 + 1 ];
+    d[ i * 2 + 1 ] = lo;
+  }
+}
+
+static CONVERT_KERNEL g_reference_kernel = {
+  "ref",
+  CONVERT_MPU_68000,
+  reference_to_16bit,
+  reference_to_8bit,
+  reference_swap_words,
+};
+
+//
+//  MPU type set by IPL-ROM in the IOCS work area
+//
+int16_t convert_get_mpu_type(void) {
+  return B_BPEEK((uint8_t*)0x0cbc);
+}
+
+//
+//  a kernel runs well on this MPU (the 68060 lacks some 68020 instructions, the 68020 variant is for 020/030/040)
+//
+static int16_t is_runnable(CONVERT_KERNEL* kernel, int16_t mpu_type) {
+  if (mpu_type < kernel->min_mpu_type) return 0;
+  if (kernel->min_mpu_type == CONVERT_MPU_68020 && mpu_type == CONVERT_MPU_68060) return 0;
+  return 1;
+}
+
+//
+//  choose the conversion kernels for the MPU
+//
+CONVERT_KERNEL* convert_select(int16_t mpu_type) {
+  for (int16_t i = 0; i < NUM_KERNELS; i++) {
+    if (is_runnable(g_kernels[i], mpu_type)) return g_kernels[i];
+  }
+  return &convert_kernel_68000;
+}
+
+//
+//  run a kernel of the benchmark (bits 0 is the wav word swap of 2 words per frame)
+//
+static size_t run_kernel(CONVERT_KERNEL* kernel, int16_t bits, int16_t* dst, const int16_t* src, size_t frames, int16_t mode, uint32_t* frame_count) {
+  if (bits == 16) return kernel->to_16bit(dst, src, frames, mode, frame_count);
+  if (bits == 8) return kernel->to_8bit((int8_t*)dst, src, frames, mode, frame_count);
+  kernel->swap_words(dst, src, frames * 2);
+  return frames * 2;
+}
+
+//
+//  time the reference and every runnable kernel variant on synthetic data and check the output against the reference
+//  (one line per kernel and mode: kernel, mode, KB/s of 16bit stereo input, speed ratio to the reference, result)
+//
+int32_t convert_benchmark(int16_t mpu_type) {
+
+  // default return code
+  int32_t rc = -1;
+
+  static const uint8_t* mode_names[] = { "16bit-stereo-half", "16bit-mono", "16bit-mono-half", "8bit-stereo", "8bit-stereo-half", "8bit-mono", "8bit-mono-half", "wav-swap" };
+  static const int16_t modes[] = { CONVERT_HALF_RATE, CONVERT_MONO, CONVERT_MONO | CONVERT_HALF_RATE, 0, CONVERT_HALF_RATE, CONVERT_MONO, CONVERT_MONO | CONVERT_HALF_RATE, 0 };
+  static const int16_t bits[] = { 16, 16, 16, 8, 8, 8, 8, 0 };
+  #define NUM_MODES (sizeof(modes) / sizeof(modes[0]))
+  uint32_t ref_kb_per_sec[ NUM_MODES ] = { 0 };
+
+  int16_t* src = himem_malloc(BENCH_FRAMES * 4, 0);
+  int16_t* dst = himem_malloc(BENCH_FRAMES * 4 + 4, 0);
+  int16_t* ref = himem_malloc(BENCH_FRAMES * 4 + 4, 0);
+  if (src == NULL || dst == NULL || ref == NULL) {
+    printf("error: benchmark buffer allocation error. (out of memory?)\n");
+    goto exit;
+  }
+
+  // full scale noise with both signs
+  uint32_t seed = 44100;
+  for (size_t i = 0; i < BENCH_FRAMES * 2; i++) {
+    seed = seed * 1103515245 + 12345;
+    src[i] = SAMPLE((int16_t)(seed >> 16));
+  }
+
+  printf("MPU type: %d\n", mpu_type);
+  printf("%-8s %-18s %8s %6s  %s\n", "kernel", "mode", "KB/s", "ratio", "result");
+
+  for (int16_t k = -1; k < (int16_t)NUM_KERNELS; k++) {
+    CONVERT_KERNEL* kernel = k < 0 ? &g_reference_kernel : g_kernels[k];
+    for (int16_t m = 0; m < NUM_MODES; m++) {
+
+      if (!is_runnable(kernel, mpu_type)) {
+        printf("%-8s %-18s %8s %6s  skipped\n", kernel->name, mode_names[m], "-", "-");
+        continue;
+      }
+
+      // repeated for BENCH_USEC at least (the clock has 50usec steps, the host runs a call in a few of them)
+      uint32_t t0 = profile_get_usec();
+      uint32_t usec = 0;
+      uint32_t loops = 0;
+      size_t len = 0;
+      do {
+        uint32_t frame_count = 0;
+        len = run_kernel(kernel, bits[m], dst, src, BENCH_FRAMES, modes[m], &frame_count);
+        loops++;
+        usec = profile_get_usec() - t0;
+      } while (usec < BENCH_USEC);
+
+      // the phase and the odd start address of the next call are checked with a split call
+      // (the word swap is checked in place for the rest, as wav_read calls it)
+      uint32_t frame_count = 0;
+      size_t ref_len = run_kernel(&g_reference_kernel, bits[m], ref, src, BENCH_FRAMES, modes[m], &frame_count);
+      frame_count = 0;
+      size_t split = run_kernel(kernel, bits[m], dst, src, 3, modes[m], &frame_count);
+      size_t split_len = split;
+      if (bits[m] == 0) {
+        memcpy(dst + split, src + 6, (BENCH_FRAMES - 3) * 4);
+        kernel->swap_words(dst + split, dst + split, (BENCH_FRAMES - 3) * 2);
+        split_len += (BENCH_FRAMES - 3) * 2;
+      } else {
+        split_len += bits[m] == 16 ? kernel->to_16bit(dst + split, src + 6, BENCH_FRAMES - 3, modes[m], &frame_count) :
+                                     kernel->to_8bit((int8_t*)dst + split, src + 6, BENCH_FRAMES - 3, modes[m], &frame_count);
+      }
+      size_t bytes = ref_len * (bits[m] == 8 ? 1 : 2);
+      int16_t ok = len == ref_len && split_len == ref_len && memcmp(dst, ref, bytes) == 0;
+
+      uint32_t kb = BENCH_FRAMES * 4 / 1024 * loops;
+      uint32_t kb_per_sec = kb * 1000 / (usec / 1000);
+      if (k < 0) ref_kb_per_sec[m] = kb_per_sec;
+      uint32_t ratio = ref_kb_per_sec[m] > 0 ? kb_per_sec * 100 / ref_kb_per_sec[m] : 0;
+      printf("%-8s %-18s %8d %3d.%02d  %s\n", kernel->name, mode_names[m], kb_per_sec, ratio / 100, ratio % 100, ok ? "ok" : "MISMATCH");
+      if (!ok) goto exit;
+    }
+  }
+
+  rc = 0;
+
+exit:
+  if (ref != NULL) himem_free(ref, 0);
+  if (dst != NULL) himem_free(dst, 0);
+  if (src != NULL) himem_free(src, 0);
+  return rc;
+}
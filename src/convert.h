@@ -0,0 +1,39 @@
+#ifndef __H_CONVERT__
+#define __H_CONVERT__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// conversion modes
+#define CONVERT_MONO      (0x01)
+#define CONVERT_HALF_RATE (0x02)
+
+// MPU types in the IOCS work area ($0CBC)
+#define CONVERT_MPU_68000 (0)
+#define CONVERT_MPU_68020 (2)
+#define CONVERT_MPU_68030 (3)
+#define CONVERT_MPU_68040 (4)
+#define CONVERT_MPU_68060 (6)
+
+//
+//  16bit stereo to 16bit / 8bit conversion kernels built for one CPU variant
+//  (frames in stereo frames, frame_count keeps the half rate phase across calls, returns output samples)
+//  and the little endian to big endian word swap of wav data (len in words, dst can be src)
+//
+typedef struct {
+  const uint8_t* name;
+  int16_t min_mpu_type;
+  size_t (*to_16bit)(int16_t* dst, const int16_t* src, size_t frames, int16_t mode, uint32_t* frame_count);
+  size_t (*to_8bit)(int8_t* dst, const int16_t* src, size_t frames, int16_t mode, uint32_t* frame_count);
+  void (*swap_words)(int16_t* dst, const int16_t* src, size_t len);
+} CONVERT_KERNEL;
+
+extern CONVERT_KERNEL convert_kernel_68000;
+extern CONVERT_KERNEL convert_kernel_68020;
+extern CONVERT_KERNEL convert_kernel_68060;
+
+int16_t convert_get_mpu_type(void);
+CONVERT_KERNEL* convert_select(int16_t mpu_type);
+int32_t convert_benchmark(int16_t mpu_type);
+
+#endif
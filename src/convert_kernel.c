@@ -0,0 +1,265 @@
+//
+//  conversion kernels, compiled once for each CPU variant
+//  (make-xdev68k.sh builds this file with -m68000, -m68020 and -m68060 and CONVERT_VARIANT set accordingly)
+//
+//  A stereo frame is read as one longword and 2-4 output samples are packed into a word or a longword
+//  before they are stored. 8bit samples are the upper bytes (arithmetic shift, not division), and the
+//  68000/68020 builds gather them with movep, which the 68060 does not have.
+//  The wav word swap is ror.w #8 per word on the 68000 and 2 words per longword on the 68020/68060.
+//
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "sample.h"
+#include "convert.h"
+
+#ifndef CONVERT_VARIANT
+#define CONVERT_VARIANT 68000
+#endif
+
+#define CONVERT_CONCAT_(a,b) a##b
+#define CONVERT_CONCAT(a,b)  CONVERT_CONCAT_(a,b)
+#define CONVERT_STR_(a)      #a
+#define CONVERT_STR(a)       CONVERT_STR_(a)
+
+#if CONVERT_VARIANT == 68060
+#define CONVERT_MIN_MPU CONVERT_MPU_68060
+#elif CONVERT_VARIANT == 68020
+#define CONVERT_MIN_MPU CONVERT_MPU_68020
+#else
+#define CONVERT_MIN_MPU CONVERT_MPU_68000
+#endif
+
+// movep loads every other byte into a register (the upper bytes of 2 or 4 big endian samples), the host
+// simulation build emulates it so that the same paths are checked against the reference
+#if CONVERT_VARIANT != 68060
+#define CONVERT_USE_MOVEP
+#ifdef __HOST_SIM__
+#define MOVEP_L(v,p) { const uint8_t* b_ = (const uint8_t*)(p); (v) = ((uint32_t)b_[0] << 24) | ((uint32_t)b_[2] << 16) | ((uint32_t)b_[4] << 8) | b_[6]; }
+#define MOVEP_W(v,p) { const uint8_t* b_ = (const uint8_t*)(p); (v) = ((uint16_t)b_[0] << 8) | b_[2]; }
+#else
+#define MOVEP_L(v,p) asm ("movep.l 0(%1),%0" : "=d" (v) : "a" (p), "m" (*(const uint32_t (*)[2])(p)))
+#define MOVEP_W(v,p) asm ("movep.w 0(%1),%0" : "=d" (v) : "a" (p), "m" (*(p)))
+#endif
+#endif
+
+// byte swap of both words of a longword (ror.w/swap/ror.w/swap in registers, the host simulation build in C)
+#if CONVERT_VARIANT != 68000
+#ifdef __HOST_SIM__
+#define SWAP_WORDS_L(v) { (v) = (((v) << 8) & 0xff00ff00) | (((v) >> 8) & 0x00ff00ff); }
+#else
+#define SWAP_WORDS_L(v) asm ("ror.w #8,%0\n\tswap %0\n\tror.w #8,%0\n\tswap %0" : "+d" (v))
+#endif
+#endif
+
+// samples of a stereo frame longword and samples packed in memory order (PCM data are big endian,
+// longwords are loaded and stored through SAMPLE32 and words through SAMPLE, see sample.h)
+#define FRAME_L(v)       ((int16_t)((v) >> 16))
+#define FRAME_R(v)       ((int16_t)(v))
+#define PACK16(a,b)      (((uint32_t)(uint16_t)(a) << 16) | (uint16_t)(b))
+#define PACK8(a,b)       ((uint16_t)(((uint8_t)(a) << 8) | (uint8_t)(b)))
+#define PACK8x4(a,b,c,d) (((uint32_t)PACK8(a,b) << 16) | PACK8(c,d))
+
+#define MONO16(v) ((int16_t)(((int32_t)FRAME_L(v) + FRAME_R(v)) >> 1))
+#define MONO8(v)  ((int8_t)(((int32_t)FRAME_L(v) + FRAME_R(v)) >> 9))
+#define HIGH8(x)  ((int8_t)((x) >> 8))
+
+//
+//  first source frame and number of output frames (in half rate mode the odd numbered frames
+//  of the whole track are kept, frame_count carries the phase to the next call)
+//
+static const uint32_t* setup(const int16_t* src, size_t frames, int16_t mode, uint32_t* frame_count, int16_t* stride, size_t* out_frames) {
+  const uint32_t* s = (const uint32_t*)src;
+  *stride = 1;
+  *out_frames = frames;
+  if (mode & CONVERT_HALF_RATE) {
+    size_t phase = *frame_count & 0x01;
+    s += phase;
+    *stride = 2;
+    *out_frames = frames > phase ? (frames - phase + 1) / 2 : 0;
+  }
+  *frame_count += frames;
+  return s;
+}
+
+//
+//  16bit stereo to 16bit mono/stereo, full or half rate
+//
+static size_t to_16bit(int16_t* dst, const int16_t* src, size_t frames, int16_t mode, uint32_t* frame_count) {
+
+  int16_t stride;
+  size_t n;
+  const uint32_t* s = setup(src, frames, mode, frame_count, &stride, &n);
+
+  if (mode & CONVERT_MONO) {
+
+    // 2 frames into a longword
+    uint32_t* d = (uint32_t*)dst;
+    for (size_t i = 0; i < n / 2; i++) {
+      uint32_t v0 = SAMPLE32(s[0]);
+      uint32_t v1 = SAMPLE32(s[ stride ]);
+      *d++ = SAMPLE32(PACK16(MONO16(v0), MONO16(v1)));
+      s += stride * 2;
+    }
+    if (n & 0x01) {
+      dst[ n - 1 ] = SAMPLE(MONO16(SAMPLE32(s[0])));
+    }
+    return n;
+
+  } else if (stride == 1) {
+
+    memcpy(dst, src, frames * 2 * sizeof(int16_t));
+    return frames * 2;
+
+  } else {
+
+    // every other frame as is
+    uint32_t* d = (uint32_t*)dst;
+    for (size_t i = 0; i < n / 2; i++) {
+      d[0] = s[0];
+      d[1] = s[2];
+      d += 2;
+      s += 4;
+    }
+    if (n & 0x01) {
+      *d = s[0];
+    }
+    return n * 2;
+
+  }
+}
+
+//
+//  16bit stereo to 8bit mono/stereo, full or half rate
+//
+static size_t to_8bit(int8_t* dst, const int16_t* src, size_t frames, int16_t mode, uint32_t* frame_count) {
+
+  int16_t stride;
+  size_t n;
+  const uint32_t* s = setup(src, frames, mode, frame_count, &stride, &n);
+
+  if (mode & CONVERT_MONO) {
+
+    // 1 byte per frame, the output may start at an odd address after an odd length call
+    int8_t* d8 = dst;
+    size_t i = 0;
+    if (((uintptr_t)d8 & 0x01) && i < n) {
+      *d8++ = MONO8(SAMPLE32(s[0]));
+      s += stride;
+      i++;
+    }
+    // 4 frames into a longword
+    uint32_t* d = (uint32_t*)d8;
+    for (; i + 4 <= n; i += 4) {
+      *d++ = SAMPLE32(PACK8x4(MONO8(SAMPLE32(s[0])), MONO8(SAMPLE32(s[ stride ])),
+                              MONO8(SAMPLE32(s[ stride * 2 ])), MONO8(SAMPLE32(s[ stride * 3 ]))));
+      s += stride * 4;
+    }
+    d8 = (int8_t*)d;
+    for (; i < n; i++) {
+      *d8++ = MONO8(SAMPLE32(s[0]));
+      s += stride;
+    }
+    return n;
+
+  } else {
+
+    // 2 frames (4 samples) into a longword
+    uint32_t* d = (uint32_t*)dst;
+    if (stride == 1) {
+      for (size_t i = 0; i < n / 2; i++) {
+#ifdef CONVERT_USE_MOVEP
+        // upper bytes of 4 consecutive words in one instruction
+        uint32_t v;
+        MOVEP_L(v, s);
+        *d++ = SAMPLE32(v);
+#else
+        uint32_t v0 = SAMPLE32(s[0]);
+        uint32_t v1 = SAMPLE32(s[1]);
+        *d++ = SAMPLE32(PACK8x4(HIGH8(FRAME_L(v0)), HIGH8(FRAME_R(v0)), HIGH8(FRAME_L(v1)), HIGH8(FRAME_R(v1))));
+#endif
+        s += 2;
+      }
+    } else {
+      for (size_t i = 0; i < n / 2; i++) {
+#ifdef CONVERT_USE_MOVEP
+        uint16_t v0, v1;
+        MOVEP_W(v0, s);
+        MOVEP_W(v1, s + 2);
+        *d++ = SAMPLE32(((uint32_t)v0 << 16) | v1);
+#else
+        uint32_t v0 = SAMPLE32(s[0]);
+        uint32_t v1 = SAMPLE32(s[2]);
+        *d++ = SAMPLE32(PACK8x4(HIGH8(FRAME_L(v0)), HIGH8(FRAME_R(v0)), HIGH8(FRAME_L(v1)), HIGH8(FRAME_R(v1))));
+#endif
+        s += 4;
+      }
+    }
+    if (n & 0x01) {
+      uint32_t v = SAMPLE32(s[0]);
+      *(uint16_t*)d = SAMPLE(PACK8(HIGH8(FRAME_L(v)), HIGH8(FRAME_R(v))));
+    }
+    return n * 2;
+
+  }
+}
+
+//
+//  little endian to big endian word swap of wav data
+//
+static void swap_words(int16_t* dst, const int16_t* src, size_t len) {
+
+#if CONVERT_VARIANT == 68000
+
+  // 4 words per loop, a longword swap takes as many cycles as 2 word swaps on the 68000
+  const uint16_t* s = (const uint16_t*)src;
+  uint16_t* d = (uint16_t*)dst;
+  for (size_t i = len / 4; i > 0; i--) {
+    uint16_t v0 = s[0];
+    uint16_t v1 = s[1];
+    uint16_t v2 = s[2];
+    uint16_t v3 = s[3];
+    d[0] = (uint16_t)((v0 << 8) | (v0 >> 8));
+    d[1] = (uint16_t)((v1 << 8) | (v1 >> 8));
+    d[2] = (uint16_t)((v2 << 8) | (v2 >> 8));
+    d[3] = (uint16_t)((v3 << 8) | (v3 >> 8));
+    s += 4;
+    d += 4;
+  }
+  for (size_t i = len & 0x03; i > 0; i--) {
+    uint16_t v = *s++;
+    *d++ = (uint16_t)((v << 8) | (v >> 8));
+  }
+
+#else
+
+  // 2 longwords (4 words) per loop, the wav buffers are word aligned, which the 68020/68060 take as longwords
+  const uint32_t* s = (const uint32_t*)src;
+  uint32_t* d = (uint32_t*)dst;
+  for (size_t i = len / 4; i > 0; i--) {
+    uint32_t v0 = s[0];
+    uint32_t v1 = s[1];
+    SWAP_WORDS_L(v0);
+    SWAP_WORDS_L(v1);
+    d[0] = v0;
+    d[1] = v1;
+    s += 2;
+    d += 2;
+  }
+  const uint16_t* s16 = (const uint16_t*)s;
+  uint16_t* d16 = (uint16_t*)d;
+  for (size_t i = len & 0x03; i > 0; i--) {
+    uint16_t v = *s16++;
+    *d16++ = (uint16_t)((v << 8) | (v >> 8));
+  }
+
+#endif
+}
+
+CONVERT_KERNEL CONVERT_CONCAT(convert_kernel_, CONVERT_VARIANT) = {
+  CONVERT_STR(CONVERT_VARIANT),
+  CONVERT_MIN_MPU,
+  to_16bit,
+  to_8bit,
+  swap_words,
+};
@@ -0,0 +1,17 @@
+#ifndef __H_DISKHOOK__
+#define __H_DISKHOOK__
+
+#include <stdint.h>
+
+// hooked IOCS calls (_B_WRITE, _B_READ, _SCSIDRV), set by _INTVCS at $100 + call number
+#define DISKHOOK_CALLS (3)
+#define DISKHOOK_VECTOR(call) (0x100 + (call))
+#define DISKHOOK_TABLE(call) (0x400 + (call) * 4)
+
+// diskhook.s (host/diskhook.c in the host simulation build), the busy count is raised while a hooked call runs
+extern const uint16_t diskhook_calls[ DISKHOOK_CALLS ];
+extern void* diskhook_entries[ DISKHOOK_CALLS ];
+extern void* diskhook_old_vectors[ DISKHOOK_CALLS ];
+extern volatile uint16_t diskhook_busy;
+
+#endif
@@ -0,0 +1,50 @@
+*
+*	disk IOCS call hooks (_B_WRITE, _B_READ, _SCSIDRV)
+*
+*	Programs may call the disk IOCS directly, outside of DOS and its InDOS flag. The busy count is raised
+*	while such a call runs, so that the timer interrupt does not start disk reads of its own in the middle of it.
+*
+
+		.xdef	diskhook_calls
+		.xdef	diskhook_entries
+		.xdef	diskhook_old_vectors
+		.xdef	diskhook_busy
+
+		.text
+		.even
+
+diskhook_b_write:
+		addq.w	#1,diskhook_busy
+		pea	diskhook_return(pc)
+		move.l	diskhook_old_vectors+0,-(sp)
+		rts
+
+diskhook_b_read:
+		addq.w	#1,diskhook_busy
+		pea	diskhook_return(pc)
+		move.l	diskhook_old_vectors+4,-(sp)
+		rts
+
+diskhook_scsidrv:
+		addq.w	#1,diskhook_busy
+		pea	diskhook_return(pc)
+		move.l	diskhook_old_vectors+8,-(sp)
+		rts
+
+diskhook_return:
+		subq.w	#1,diskhook_busy
+		rts
+
+*	kept in the text so that they stay within the resident part
+		.even
+
+diskhook_calls:
+		.dc.w	$45,$46,$f5
+diskhook_entries:
+		.dc.l	diskhook_b_write,diskhook_b_read,diskhook_scsidrv
+diskhook_old_vectors:
+		.dc.l	0,0,0
+diskhook_busy:
+		.dc.w	0
+
+		end
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <doslib.h>
+#include "profile.h"
+#include "dosio.h"
+
+//
+//  DOS _READ with time accounting
+//
+static size_t __dosio_read(DOSIO_HANDLE* io, uint8_t* buffer, size_t bytes) {
+
+  uint32_t t0 = profile_get_usec();
+  int32_t rc = READ(io->fd, buffer, bytes);
+
+  io->read_time += profile_get_usec() - t0;
+  io->read_calls++;
+  if (rc <= 0) return 0;
+
+  io->read_bytes += rc;
+  io->file_ofs += rc;
+
+  return (size_t)rc;
+}
+
+//
+//  open a file for reading with DOS _OPEN, bypassing stdio buffering (file_bytes < 0: probed by seeking to the end)
+//
+static int32_t __dosio_open(DOSIO_HANDLE* io, const uint8_t* file_name, int32_t file_bytes) {
+
+  io->fd = -1;
+  io->opened = 0;
+  io->file_bytes = 0;
+  io->file_ofs = 0;
+  io->open_time = 0;
+  io->probe_time = 0;
+  io->read_time = 0;
+  io->read_bytes = 0;
+  io->read_calls = 0;
+
+  uint32_t t0 = profile_get_usec();
+  int32_t fd = OPEN((uint8_t*)file_name, 0);
+  uint32_t t1 = profile_get_usec();
+  io->open_time = t1 - t0;
+  if (fd < 0) return -1;
+
+  io->fd = fd;
+  io->opened = 1;
+
+  // file size
+  if (file_bytes < 0) {
+    file_bytes = SEEK(fd, 0, 2);
+    SEEK(fd, 0, 0);
+    io->probe_time = profile_get_usec() - t1;
+  }
+  io->file_bytes = file_bytes < 0 ? 0 : file_bytes;
+
+  return 0;
+}
+
+int32_t dosio_open(DOSIO_HANDLE* io, const uint8_t* file_name) {
+  return __dosio_open(io, file_name, -1);
+}
+
+//
+//  open a file of a known size (from a directory lookup, e.g. a valid metadata cache entry) without the size probe
+//
+int32_t dosio_open_size(DOSIO_HANDLE* io, const uint8_t* file_name, size_t file_bytes) {
+  return __dosio_open(io, file_name, (int32_t)file_bytes);
+}
+
+//
+//  close file
+//
+void dosio_close(DOSIO_HANDLE* io) {
+  if (io->opened) {
+    CLOSE(io->fd);
+    io->fd = -1;
+    io->opened = 0;
+  }
+}
+
+//
+//  read bytes (fread compatible, returns read bytes)
+//  large reads are split so that the bulk of the transfer starts at a sector boundary,
+//  which lets the device driver transfer whole sectors directly into the buffer
+//  (a plain synchronous _READ into the one staging buffer of the loader, there is no read-ahead: the
+//  conversion of a chunk starts when its read has returned)
+//
+size_t dosio_read(DOSIO_HANDLE* io, void* buffer, size_t bytes) {
+
+  uint8_t* p = (uint8_t*)buffer;
+  size_t read_bytes = 0;
+
+  size_t head_bytes = (DOSIO_SECTOR_BYTES - (io->file_ofs & (DOSIO_SECTOR_BYTES - 1))) & (DOSIO_SECTOR_BYTES - 1);
+  if (head_bytes > 0 && bytes >= head_bytes + DOSIO_SECTOR_BYTES) {
+    size_t n = __dosio_read(io, p, head_bytes);
+    read_bytes += n;
+    if (n < head_bytes) return read_bytes;
+  }
+
+  if (bytes > read_bytes) {
+    read_bytes += __dosio_read(io, p + read_bytes, bytes - read_bytes);
+  }
+
+  return read_bytes;
+}
+
+//
+//  seek (whence: SEEK_SET/SEEK_CUR/SEEK_END, returns 0 on success)
+//
+int32_t dosio_seek(DOSIO_HANDLE* io, int32_t ofs, int16_t whence) {
+  int32_t mode = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? 1 : 2;
+  int32_t rc = SEEK(io->fd, ofs, mode);
+  if (rc < 0) return -1;
+  io->file_ofs = rc;
+  return 0;
+}
+
+//
+//  current file offset
+//
+size_t dosio_tell(DOSIO_HANDLE* io) {
+  return io->file_ofs;
+}
+
+//
+//  file size
+//
+size_t dosio_get_size(DOSIO_HANDLE* io) {
+  return io->file_bytes;
+}
+
+//
+//  file size and timestamp by a directory lookup (DOS _FILES), without opening the file
+//
+int32_t dosio_stat(const uint8_t* file_name, uint32_t* file_bytes, uint32_t* file_time) {
+  struct FILBUF filbuf;
+  if (FILES(&filbuf, (uint8_t*)file_name, 0x27) < 0) return -1;
+  *file_bytes = filbuf.filelen;
+  *file_time = ((uint32_t)filbuf.date << 16) | filbuf.time;
+  return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef __H_DOSIO__
+#define __H_DOSIO__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DOSIO_SECTOR_BYTES (1024)
+
+// file reads of the loader with DOS _OPEN/_READ/_SEEK: large sector aligned reads, not overlapped with the conversion
+
+typedef struct {
+  int32_t fd;
+  int16_t opened;
+  size_t file_bytes;
+  size_t file_ofs;
+  uint32_t open_time;     // in usec
+  uint32_t probe_time;    // in usec
+  uint32_t read_time;     // in usec
+  size_t read_bytes;
+  uint32_t read_calls;
+} DOSIO_HANDLE;
+
+int32_t dosio_open(DOSIO_HANDLE* io, const uint8_t* file_name);
+int32_t dosio_open_size(DOSIO_HANDLE* io, const uint8_t* file_name, size_t file_bytes);
+void dosio_close(DOSIO_HANDLE* io);
+size_t dosio_read(DOSIO_HANDLE* io, void* buffer, size_t bytes);
+int32_t dosio_seek(DOSIO_HANDLE* io, int32_t ofs, int16_t whence);
+size_t dosio_tell(DOSIO_HANDLE* io);
+size_t dosio_get_size(DOSIO_HANDLE* io);
+int32_t dosio_stat(const uint8_t* file_name, uint32_t* file_bytes, uint32_t* file_time);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __H_KEYHOOK__
+#define __H_KEYHOOK__
+
+#include <stdint.h>
+
+// MFP receive buffer full interrupt of the keyboard
+#define KEYHOOK_VECTOR (0x4c)
+
+// keyhook.s (host/keyhook.c in the host simulation build), the callback is called after the original handler
+extern void keyhook_entry(void);
+extern void* keyhook_old_vector;
+extern void (*keyhook_callback)(void);
+
+#endif
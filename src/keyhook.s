@@ -0,0 +1,40 @@
+*
+*	keyboard interrupt hook (MFP receive buffer full, vector $4c)
+*
+*	The original handler is entered with an exception frame of our own, so that its rte comes back here
+*	after the key matrix and the shift status were updated. Then the callback is called as a C function.
+*
+
+		.xdef	keyhook_entry
+		.xdef	keyhook_old_vector
+		.xdef	keyhook_callback
+
+		.text
+		.even
+
+keyhook_entry:
+		tst.b	($0cbc)			* MPU type, 68010 and later stack a format word
+		beq	@f
+		move.w	#$4c*4,-(sp)		* format 0, vector offset
+@@:
+		pea	keyhook_return(pc)
+		move.w	sr,-(sp)
+		move.l	keyhook_old_vector,-(sp)
+		rts
+
+keyhook_return:
+		movem.l	d0-d2/a0-a2,-(sp)
+		movea.l	keyhook_callback,a0
+		jsr	(a0)
+		movem.l	(sp)+,d0-d2/a0-a2
+		rte
+
+*	kept in the text so that they stay within the resident part
+		.even
+
+keyhook_old_vector:
+		.dc.l	0
+keyhook_callback:
+		.dc.l	0
+
+		end
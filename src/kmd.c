@@ -25,6 +25,8 @@ int32_t kmd_init(KMD_HANDLE* kmd, FILE* fp) {
   kmd->tag_title[0] = '\0';
   kmd->tag_artist[0] = '\0';
   kmd->tag_album[0] = '\0';
+  kmd->loop_start = 0;
+  kmd->loop_end = 0;
 
   // KMD file header check
   if (fp == NULL) goto exit;
@@ -66,6 +68,12 @@ int32_t kmd_init(KMD_HANDLE* kmd, FILE* fp) {
             } else if (memcmp(m0 + 1, "TALB:", 5) == 0) {
               memcpy(kmd->tag_album, m0 + 6, m_len - 5);
               kmd->tag_album[ m_len ] = '\0';
+            } else if (memcmp(m0 + 1, "LOOP:", 5) == 0) {
+              uint32_t loop_start, loop_end;
+              if (sscanf(m0 + 6, "%d-%d", &loop_start, &loop_end) == 2 && loop_start < loop_end) {
+                kmd->loop_start = loop_start;
+                kmd->loop_end = loop_end;
+              }
 //            } else if (memcmp(m0 + 1, "APIC:", 5) == 0) {
 //              memcpy(kmd->tag_artwork, m0 + 6, m_len - 5);
 //              kmd->tag_artwork[ m_len ] = '\0';
@@ -112,3 +120,14 @@ KMD_EVENT* kmd_next_event(KMD_HANDLE* kmd) {
   kmd->current_event_ofs++;
   return next_event;
 }
+
+//
+//  move all events earlier (the silence at the top of the track was trimmed)
+//
+void kmd_shift(KMD_HANDLE* kmd, uint32_t msec) {
+  for (size_t i = 0; i < kmd->num_events; i++) {
+    KMD_EVENT* e = &(kmd->events[i]);
+    e->start_msec = e->start_msec > msec ? e->start_msec - msec : 0;
+    e->end_msec = e->end_msec > msec ? e->end_msec - msec : 0;
+  }
+}
@@ -26,10 +26,13 @@ typedef struct {
   uint8_t tag_title[ KMD_MAX_MESSAGE_LEN + 1 ];
   uint8_t tag_artist[ KMD_MAX_MESSAGE_LEN + 1 ];
   uint8_t tag_album[ KMD_MAX_MESSAGE_LEN + 1 ];
+  uint32_t loop_start;        // loop region in 44.1kHz frames of the LOOP: tag (loop_end 0: none)
+  uint32_t loop_end;
 } KMD_HANDLE;
 
 int32_t kmd_init(KMD_HANDLE* kmd, FILE* fp);
 void kmd_close(KMD_HANDLE* kmd);
 KMD_EVENT* kmd_next_event(KMD_HANDLE* kmd);
+void kmd_shift(KMD_HANDLE* kmd, uint32_t msec);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "loop.h"
+
+//
+//  links of a buffer region in as large chunks as PCM8PP takes, returns the next free link
+//
+static int16_t add_links(LOOP_PLAYER* lp, int16_t n, uint8_t* buffer, uint32_t start, uint32_t end) {
+  for (uint32_t ofs = start; ofs < end && n < LOOP_MAX_LINKS; ofs += LOOP_LINK_BYTES) {
+    lp->links[n].addr = buffer + ofs;
+    lp->links[n].length = end - ofs > LOOP_LINK_BYTES ? LOOP_LINK_BYTES : end - ofs;
+    lp->links[n].next = &(lp->links[ n + 1 ]);
+    n++;
+  }
+  return n;
+}
+
+//
+//  intro and loop body fit in the chain of a player
+//
+int16_t loop_fits(uint32_t loop_start, uint32_t loop_end) {
+  uint32_t intro_links = (loop_start + LOOP_LINK_BYTES - 1) / LOOP_LINK_BYTES;
+  uint32_t body_links = (loop_end - loop_start + LOOP_LINK_BYTES - 1) / LOOP_LINK_BYTES;
+  return intro_links + body_links < LOOP_MAX_LINKS ? 1 : 0;
+}
+
+//
+//  start playback of the intro followed by the endlessly repeated loop body (linked array chain mode)
+//
+int32_t loop_play(LOOP_PLAYER* lp, int16_t channel, uint32_t mode, uint32_t freq, void* buffer, uint32_t loop_start, uint32_t loop_end) {
+
+  int16_t n = add_links(lp, 0, buffer, 0, loop_start);
+  lp->body_link = n;
+  n = add_links(lp, n, buffer, loop_start, loop_end);
+  if (n <= lp->body_link || n >= LOOP_MAX_LINKS) return -1;
+
+  // the end of the body goes back to its top, which joins the loop at the exact sample
+  lp->links[ n - 1 ].next = &(lp->links[ lp->body_link ]);
+  lp->num_links = n;
+  lp->resume_link.addr = NULL;
+  lp->resume_link.next = NULL;
+
+  return pcm8pp_play_linked_array_chain(channel, mode, 0, freq, lp->links);
+}
+
+//
+//  restart playback at a byte offset of the unrolled track, the chain is entered through a copy of the link
+//  that holds the offset
+//
+int32_t loop_resume(LOOP_PLAYER* lp, int16_t channel, uint32_t mode, uint32_t freq, uint32_t ofs) {
+
+  uint8_t* buffer = (uint8_t*)lp->links[0].addr;
+  uint8_t* body = (uint8_t*)lp->links[ lp->body_link ].addr;
+  uint8_t* end = (uint8_t*)lp->links[ lp->num_links - 1 ].addr + lp->links[ lp->num_links - 1 ].length;
+
+  // repetitions of the body are folded into the one in the buffer
+  uint8_t* p = buffer + ofs;
+  if (p >= end) {
+    p = body + (uint32_t)(p - body) % (uint32_t)(end - body);
+  }
+
+  for (int16_t i = 0; i < lp->num_links; i++) {
+    PCM8PP_LINK* link = &(lp->links[i]);
+    if (p >= (uint8_t*)link->addr && p < (uint8_t*)link->addr + link->length) {
+      lp->resume_link.addr = p;
+      lp->resume_link.length = (uint8_t*)link->addr + link->length - p;
+      lp->resume_link.next = link->next;
+      return pcm8pp_play_linked_array_chain(channel, mode, 0, freq, &(lp->resume_link));
+    }
+  }
+
+  return -1;
+}
+
+//
+//  end the chain after the loop body being played (the last repetition)
+//
+void loop_cut(LOOP_PLAYER* lp) {
+  if (lp->num_links > 0) {
+    lp->links[ lp->num_links - 1 ].next = NULL;
+  }
+  // playback resumed in the last link of the body goes on through the copy
+  if (lp->resume_link.next == &(lp->links[ lp->body_link ]) && lp->resume_link.addr >= lp->links[ lp->body_link ].addr) {
+    lp->resume_link.next = NULL;
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef __H_LOOP__
+#define __H_LOOP__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pcm8pp.h"
+
+// a link holds less than 64KB in whole frames of every PCM mode (about 190sec of 44.1kHz 16bit stereo in all)
+#define LOOP_LINK_BYTES (0xff00)
+#define LOOP_MAX_LINKS  (512)
+
+// the loop body is repeated by a circular chain, which is cut in the middle of the last repetition
+// (the body is long enough for the interrupt clock to hit it)
+#define LOOP_MIN_BODY_MSEC (1000)
+#define LOOP_NO_CUT        (0xffffffff)
+#define LOOP_MAX_COUNT     (999)
+
+// chain of the track played on a channel (intro links, then the loop body links pointing back to its first one)
+typedef struct {
+  PCM8PP_LINK links[ LOOP_MAX_LINKS ];
+  int16_t num_links;
+  int16_t body_link;
+  PCM8PP_LINK resume_link;
+} LOOP_PLAYER;
+
+int16_t loop_fits(uint32_t loop_start, uint32_t loop_end);
+int32_t loop_play(LOOP_PLAYER* lp, int16_t channel, uint32_t mode, uint32_t freq, void* buffer, uint32_t loop_start, uint32_t loop_end);
+int32_t loop_resume(LOOP_PLAYER* lp, int16_t channel, uint32_t mode, uint32_t freq, uint32_t ofs);
+void loop_cut(LOOP_PLAYER* lp);
+
+#endif
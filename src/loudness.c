@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "sample.h"
+#include "loudness.h"
+
+//
+//  integer square root
+//
+static uint32_t isqrt(uint32_t x) {
+  uint32_t r = 0;
+  uint32_t b = 1UL << 30;
+  while (b > x) b >>= 2;
+  while (b != 0) {
+    if (x >= r + b) {
+      x -= r + b;
+      r = (r >> 1) + b;
+    } else {
+      r >>= 1;
+    }
+    b >>= 2;
+  }
+  return r;
+}
+
+//
+//  measure a chunk of 16bit samples in the load loop (the sampling phase is kept across chunks)
+//
+void loudness_update(LOUDNESS* ld, const int16_t* samples, size_t len) {
+  size_t i = ld->skip;
+  for (; i < len; i += LOUDNESS_STRIDE) {
+    int16_t x = SAMPLE(samples[i]);
+    ld->sum += (uint32_t)((int32_t)x * x);
+    uint16_t a = x < 0 ? -(int32_t)x : x;
+    if (a > ld->peak) ld->peak = a;
+    ld->count++;
+  }
+  ld->skip = i - len;
+}
+
+//
+//  RMS level of the measured samples
+//
+uint16_t loudness_get_rms(LOUDNESS* ld) {
+  if (ld->count == 0) return 0;
+  uint32_t rms = isqrt((uint32_t)(ld->sum / ld->count));
+  return rms > 32767 ? 32767 : rms;
+}
+
+//
+//  PCM8PP volume that brings the track to the target RMS level (the given volume is kept at the target),
+//  not raised over the given volume into clipping
+//
+//  The volume table of PCM8PP has not been measured and need not be linear. A step is taken as a gain of
+//  volume/8 as the host simulation mixes it, and the result is kept within LOUDNESS_MAX_STEPS of the given
+//  volume, so that a table which differs moves a track only that far from where -v/,v put it. Tracks further
+//  from the target are brought closer to it, not to it.
+//
+int16_t loudness_get_volume(uint16_t rms, uint16_t peak, int16_t volume) {
+
+  if (rms == 0) return volume;
+
+  int32_t v = ((int32_t)volume * LOUDNESS_TARGET_RMS + rms / 2) / rms;
+  if (v < volume - LOUDNESS_MAX_STEPS) v = volume - LOUDNESS_MAX_STEPS;
+  if (v > volume + LOUDNESS_MAX_STEPS) v = volume + LOUDNESS_MAX_STEPS;
+  if (v < LOUDNESS_MIN_VOLUME) v = LOUDNESS_MIN_VOLUME;
+  if (v > LOUDNESS_MAX_VOLUME) v = LOUDNESS_MAX_VOLUME;
+
+  while (v > volume && (int32_t)peak * v > 32767 * 8) v--;
+
+  return v;
+}
@@ -0,0 +1,29 @@
+#ifndef __H_LOUDNESS__
+#define __H_LOUDNESS__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// every 31st 16bit sample is measured (odd, so that both channels of stereo data are taken)
+#define LOUDNESS_STRIDE (31)
+
+// RMS level given the track volume by -n (-18dBFS), PCM8PP volume range
+#define LOUDNESS_TARGET_RMS (4096)
+#define LOUDNESS_MIN_VOLUME (1)
+#define LOUDNESS_MAX_VOLUME (12)
+
+// volume steps -n moves away from the given volume at most (the gain of a step is assumed, see loudness.c)
+#define LOUDNESS_MAX_STEPS (2)
+
+typedef struct {
+  uint64_t sum;             // sum of squares of the measured samples
+  uint32_t count;
+  uint16_t peak;
+  uint16_t skip;            // samples to skip at the top of the next chunk
+} LOUDNESS;
+
+void loudness_update(LOUDNESS* ld, const int16_t* samples, size_t len);
+uint16_t loudness_get_rms(LOUDNESS* ld);
+int16_t loudness_get_volume(uint16_t rms, uint16_t peak, int16_t volume);
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <doslib.h>
 #include <iocslib.h>
@@ -8,163 +9,28 @@
 #include "pcm8pp.h"
 #include "ym2608_decode.h"
 #include "kmd.h"
+#include "dosio.h"
+#include "profile.h"
+#include "cache.h"
+#include "stream.h"
+#include "trackcache.h"
+#include "keyhook.h"
+#include "diskhook.h"
+#include "loop.h"
+#include "silence.h"
+#include "trace.h"
+#include "convert.h"
+#include "loudness.h"
+#include "wav.h"
+#include "z44.h"
+#include "resample.h"
+#include "msm6258_encode.h"
 #include "s44bgp.h"
+#include "resident.h"
 
-#define __OPM_TIMER__
-
-static PCM_MUSIC g_pcm_music[ MAX_MUSIC ];
-static int16_t g_num_music;
-static int16_t g_quiet_mode;
-static int16_t g_shuffle_mode;
-static int16_t g_opm_timer;
-
-volatile static uint32_t g_pcm8pp_freq;
-volatile static int16_t g_current_music;
-volatile static int16_t g_paused;
-volatile static int32_t g_int_counter;
-volatile static uint32_t g_elapsed_time;
-
-#define OPM_REG_PORT  ((uint8_t*)0xE90001)
-#define OPM_DATA_PORT ((uint8_t*)0xE90003)
-
-//
-//  timer-D / OPM timer-B interrupt handler
-//
-static void __attribute__((interrupt)) __timer_interrupt_handler__(void) {
-
-  // total play time
-  if (!g_paused) {
-#ifdef __OPM_TIMER__
-    g_elapsed_time += OPM_INTERVAL_MSEC;
-#else
-    g_elapsed_time += TIMERD_INTERVAL_MSEC;
-#endif
-  }
-
-#ifdef __OPM_TIMER__
-  while (OPMSNS() & 0x80);
-  OPMSET(0x14, 0x2a);
-#endif
-
-  // check playback stop
-  if (g_int_counter == 8) {
-    if (!g_paused && pcm8pp_get_data_length(PCM8PP_CHANNEL) == 0) {
-      // really ended?
-      if (g_elapsed_time < g_pcm_music[ g_current_music ].total_time_msec - 1500) {
-        // probablly pcm8pp playback was stopped externally
-//        PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
-//        uint32_t resume_ofs = (uint32_t)((float)pcm->buffer_bytes * (float)g_elapsed_time / (float)pcm->total_time_msec / 2) & 0xfffffffc;
-//        pcm8pp_play(PCM8PP_CHANNEL, g_pcm8pp_mode, pcm->buffer_bytes - resume_ofs, 44100*256, pcm->buffer + resume_ofs);
-        pcm8pp_pause();
-        g_paused = 1;
-        if (!g_quiet_mode) {
-          B_PUTMES(6, 0, 31, 66, SJIS_ONPU "ABORTED.");
-        }
-      } else {
-        // next music
-        g_current_music = g_shuffle_mode ? rand() % g_num_music : (g_current_music + 1) % g_num_music;
-        PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
-        pcm->kmd.current_event_ofs = 0;
-        pcm8pp_play(PCM8PP_CHANNEL, ( pcm->volume << 16 ) | ( g_pcm8pp_freq << 8 ) | 0x03, pcm->buffer_bytes, 44100*256, pcm->buffer);
-        if (!g_quiet_mode) {
-          B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
-          if (pcm->kmd.tag_title[0] != '\0') {
-            B_PUTMES(6, 2, 31, 64, pcm->kmd.tag_title);
-          } else {
-            B_PUTMES(6, 2, 31, 64, pcm->file_name);
-          }
-        }
-        g_paused = 0;
-        g_elapsed_time = 0;
-      }
-    }
-  }
-
-  // check pause/resume
-#ifdef __OPM_TIMER__
-  if (g_int_counter & 0x01) {
-#else
-  if (g_int_counter == 4) {
-#endif
-//    uint8_t key1 = *((uint8_t*)0x80e);      // CTRL key
-//    uint8_t key2 = *((uint8_t*)0x80b);      // XF4/XF5 key
-    if (B_SFTSNS() & 0x02) {                  // CTRL key
-//    if (key1 & 0x02) {
-      int32_t sense_code = BITSNS(0x0b);
-      if (sense_code & 0x01) {                // CTRL + XF4 (pause/resume)
-//      if (key2 & 0x01) {                    // XF4
-        if (g_paused) {
-          pcm8pp_resume();
-          if (!g_quiet_mode) {
-            PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
-            B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
-            if (pcm->kmd.tag_title[0] != '\0') {
-              B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->kmd.tag_title);
-            } else {
-              B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->file_name);
-            }
-          }
-          g_paused = 0;
-        } else {
-          pcm8pp_pause();
-          if (!g_quiet_mode) {
-            B_PUTMES(6, 0, 31, MAX_DISP_LEN, SJIS_ONPU "PAUSED.");
-          }
-          g_paused = 1;
-        }
-      } else if (sense_code & 0x02) {         // CTRL + XF5 (skip)
-//      } else if (key2 & 0x02) {         // XF5
-        pcm8pp_stop();
-        g_current_music = g_shuffle_mode ? rand() % g_num_music : (g_current_music + 1) % g_num_music;
-        PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
-        pcm->kmd.current_event_ofs = 0;
-        pcm8pp_play(PCM8PP_CHANNEL, ( pcm->volume << 16 ) | ( g_pcm8pp_freq << 8 ) | 0x03, pcm->buffer_bytes, 44100*256, pcm->buffer);
-        if (!g_quiet_mode) {
-          B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
-          if (pcm->kmd.tag_title[0] != '\0') {
-            B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->kmd.tag_title);
-          } else {
-            B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->file_name);
-          }
-        }
-        g_paused = 0;
-        g_elapsed_time = 0;
-      }
-    }
-  }
-
-  // check KMD event
-#ifdef __OPM_TIMER__
-  if (1) {
-#else
-  if (g_int_counter == 2) {
-#endif
-    if (!g_quiet_mode) {
-      PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
-      KMD_HANDLE* kmd = &(pcm->kmd);
-      if (kmd->current_event_ofs < kmd->num_events) {
-        KMD_EVENT* event = &(kmd->events[ kmd->current_event_ofs ]);
-        if (event->start_msec <= 500) {      // do not show first 0.5 sec KMD events to ensure file name display
-          kmd->current_event_ofs++;
-        } else if (event->start_msec <= g_elapsed_time) {
-          B_PUTMES(6, event->pos_x * 2, 31, MAX_DISP_LEN - event->pos_x * 2, event->message);
-          kmd->current_event_ofs++;
-        }
-      }
-    }
-  }
-
-  // countdown
-  g_int_counter--;
-  if (g_int_counter < 0) {
-#ifdef __OPM_TIMER__
-    g_int_counter = OPM_INTERVAL_COUNT;
-#else
-    g_int_counter = TIMERD_INTERVAL_COUNT;
-#endif
-  }
-
-}
+// ADPCM decoder benchmark of -bench
+#define BENCH_ADPCM_BYTES (16384)
+#define BENCH_DECODE_USEC (200000)
 
 //
 //  keep process checker
@@ -200,24 +66,142 @@ static uint8_t* check_keep_process(const uint8_t* exec_name) {
   return NULL;
 }
 
+//
+//  player state of the running instance (the header is in its resident text at the same offset from the PDB,
+//  the running instance is the same binary)
+//
+static RESIDENT_STATE* get_resident_state(uint8_t* pdp) {
+  RESIDENT_HEADER* header = (RESIDENT_HEADER*)(pdp + ((uint8_t*)&g_resident - (uint8_t*)GETPDB()));
+  return memcmp(header->eye_catch, RESIDENT_EYE_CATCH, EYE_CATCH_LEN) == 0 ? header->state : NULL;
+}
+
+//
+//  find an earlier playlist entry of the same file loaded the same way (all entries share one conversion mode,
+//  the ,t ,l and ,r options change what is loaded and must match as well, the ,v volume is of each entry)
+//
+static int16_t find_music(int16_t index, const int16_t* resident_secs, uint32_t loop_frames[][2], const int16_t* loop_counts) {
+  for (int16_t i = 0; i < index; i++) {
+    if (!g_pcm_music[i].shared && stricmp(g_pcm_music[i].file_name, g_pcm_music[index].file_name) == 0 &&
+        resident_secs[i] == resident_secs[index] && loop_frames[i][0] == loop_frames[index][0] &&
+        loop_frames[i][1] == loop_frames[index][1] && loop_counts[i] == loop_counts[index]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+//
+//  playback time of 44.1kHz stereo frames in msec (10 * frames / 441 without overflow)
+//
+static uint32_t get_frames_msec(uint32_t frames) {
+  return frames / 441 * 10 + frames % 441 * 10 / 441;
+}
+
+//
+//  loading progress, printed only when the percentage changes (no floating point in the loader)
+//
+static void show_progress(const uint8_t* file_name, size_t done, size_t total) {
+  static const uint8_t* last_name = NULL;
+  static int16_t last_percent = -1;
+  int16_t percent = done >= total ? 100 : done / ((total + 99) / 100);
+  if (file_name == last_name && percent == last_percent) return;
+  last_name = file_name;
+  last_percent = percent;
+  printf("\rLoading %s (%3d%%) ... [SHIFT] key to cancel.", file_name, percent);
+}
+
+//
+//  time atop_exec (ym2608_adpcmlib.s) on random ADPCM bytes, mono and stereo
+//  (one line per layout: layout, KB/s of ADPCM input, samples per second, the measured time per byte in 10MHz clocks,
+//  which are 68000 cycles only on the real machine, under run68 they follow the speed of the host)
+//
+static int32_t decode_benchmark(void) {
+
+  // default return code
+  int32_t rc = -1;
+
+  static const uint8_t* layout_names[] = { "mono", "stereo" };
+  YM2608_DECODE_HANDLE nas = { 0 };
+
+  uint8_t* adpcm = himem_malloc(BENCH_ADPCM_BYTES, 0);
+  if (adpcm == NULL) {
+    printf("error: benchmark buffer allocation error. (out of memory?)\n");
+    goto exit;
+  }
+
+  uint32_t seed = 44100;
+  for (size_t i = 0; i < BENCH_ADPCM_BYTES; i++) {
+    seed = seed * 1103515245 + 12345;
+    adpcm[i] = seed >> 24;
+  }
+
+  printf("%-8s %-18s %8s %10s %10s\n", "decoder", "layout", "KB/s", "samples/s", "clk@10MHz");
+
+  for (int16_t channels = 1; channels <= 2; channels++) {
+
+    // the decode buffer takes the whole input in one call
+    if (ym2608_decode_init(&nas, BENCH_ADPCM_BYTES * 2, 44100, channels) != 0) {
+      printf("error: ADPCM decoder initialization error. (out of memory?)\n");
+      goto exit;
+    }
+
+    // repeated for BENCH_DECODE_USEC at least, as the conversion kernels
+    uint32_t t0 = profile_get_usec();
+    uint32_t usec = 0;
+    uint32_t loops = 0;
+    do {
+      ym2608_decode_exec(&nas, adpcm, BENCH_ADPCM_BYTES);
+      loops++;
+      usec = profile_get_usec() - t0;
+    } while (usec < BENCH_DECODE_USEC);
+    ym2608_decode_close(&nas);
+
+    uint32_t kb = BENCH_ADPCM_BYTES / 1024 * loops;
+    uint32_t kb_per_sec = kb * 1000 / (usec / 1000);
+    uint32_t samples_per_sec = kb_per_sec * 1024 * 2 / channels;
+    uint32_t cycles_per_byte = kb_per_sec > 0 ? 10000000 / (kb_per_sec * 1024 / 100) : 0;
+    printf("%-8s %-18s %8d %10d %7d.%02d\n", "decoder", layout_names[ channels - 1 ], kb_per_sec, samples_per_sec,
+           cycles_per_byte / 100, cycles_per_byte % 100);
+  }
+
+  rc = 0;
+
+exit:
+  if (adpcm != NULL) himem_free(adpcm, 0);
+  return rc;
+}
+
 //
 //  show help message
 //
 static void show_help_message() {
-  printf("usage: s44bgp [options] <file1.(s44|a44)> [<file2.(s44|a44)> ...]\n");
+  printf("usage: s44bgp [options] <file1.(s44|a44|z44|wav)> [<file2.(s44|a44|z44|wav)> ...]\n");
   printf("options:\n");
   printf("   -r    ... remove running s44bgp\n");
+  printf("   -stat ... show interrupt handler statistics of running s44bgp\n");
+  printf("   -trace ... show the playback event trace of running s44bgp\n");
+  printf("   -bench ... benchmark conversion kernels of each CPU variant and the ADPCM decoder\n");
   printf("   -h    ... show help message\n");
   printf("\n");
   printf("   -i <file> ... indirect file\n");
+  printf("   -c <file> ... metadata cache file\n");
   printf("\n");
   printf("   -v<n> ... volume (1-12, default:8)\n");
+  printf("   -n    ... automatic volume from the loudness of each track (-v/,v is the volume at -18dBFS RMS, +-2 steps)\n");
   printf("   -s    ... shuffle mode\n");
   printf("   -q    ... quiet mode\n");
+  printf("   -e    ... hotkeys by a keyboard interrupt hook instead of polling in the timer interrupt\n");
+  printf("   -b    ... show load throughput of the aligned reads and of the conversion\n");
+  printf("   -P    ... show load time profile of each stage (-Pt: tab separated with data checksums)\n");
+  printf("   -x<n> ... crossfade n seconds into the next track on a second PCM8PP channel (1-30)\n");
+  printf("   -t<n> ... keep only the first n seconds resident and stream the rest from disk (.s44, 16bit stereo)\n");
+  printf("   -k<n> ... keep only recent and next tracks in an n MB track cache, loaded while playing (.s44, 16bit stereo)\n");
+  printf("   -z    ... trim head and tail silences and play long internal ones from a shared zero block (PCM modes)\n");
   printf("\n");
   printf("   -2    ... 22.05kHz mode\n");
   printf("   -8    ... 8bit PCM mode\n");
   printf("   -m    ... mono mode\n");
+  printf("   -a    ... ADPCM mode (15.6kHz mono 4bit, overrides -2/-8/-m)\n");
 }
 
 //
@@ -230,29 +214,74 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
 
   // option parameters
   int16_t remove_mode = 0;
+  int16_t stat_mode = 0;
+  int16_t trace_mode = 0;
+  int16_t kernel_bench_mode = 0;
   int16_t pcm_volume = 8;
+  int16_t auto_volume = 0;
   int16_t pcm_half_rate = 0;
   int16_t pcm_half_bit = 0;
+  int16_t pcm_adpcm = 0;
   int16_t pcm_channels = 2;
   int16_t shuffle_mode = 0;
   int16_t quiet_mode = 0;
+  int16_t key_hook = 0;
+  int16_t bench_mode = 0;
+  int16_t profile_mode = 0;
+  int16_t resident_sec = 0;
+  int16_t crossfade_sec = 0;
+  int16_t track_cache_mb = 0;
+  int16_t silence_mode = 0;
+  uint32_t track_slot_bytes = 0;
   int16_t num_music = 0;
 
-  // init PCM_MUSIC array
-  memset(g_pcm_music, 0, sizeof(PCM_MUSIC) * MAX_MUSIC);
+  // resident seconds of each track (0: whole track, streamed only when it does not fit)
+  int16_t resident_secs[ MAX_MUSIC ] = { 0 };
+
+  // loop region of each track in 44.1kHz frames (end 0: none or the KMD tag) and repetitions (0: endless, -1: as in the file)
+  uint32_t loop_frames[ MAX_MUSIC ][2] = { 0 };
+  int16_t loop_counts[ MAX_MUSIC ];
+
+  // player state (kept resident with the process), PCM_MUSIC array
+  if (resident_open() != 0) {
+    printf("error: main memory allocation error. (out of memory?)\n");
+    return rc;
+  }
   for (int16_t i = 0; i < MAX_MUSIC; i++) {
     memcpy(g_pcm_music[i].eye_catch, EYE_CATCH, EYE_CATCH_LEN);
+    loop_counts[i] = -1;
   }
  
   // file read pointer
   FILE* fp = NULL;
 
+  // pcm data file handle
+  DOSIO_HANDLE pcm_io = { 0 };
+
   // file read staging buffer
   int16_t* fread_buffer = NULL;
 
   // ym2608 decode handle
   YM2608_DECODE_HANDLE ym2608_decode = { 0 };
 
+  // sample rate converter handle
+  RESAMPLE_HANDLE resampler = { 0 };
+
+  // msm6258 encode handle
+  MSM6258_ENCODE_HANDLE msm6258_encode = { 0 };
+
+  // z44 reader handle
+  Z44_HANDLE z44_reader = { 0 };
+
+  // metadata cache
+  CACHE_HANDLE cache = { 0 };
+  CACHE_ENTRY* cached_entries[ MAX_MUSIC ] = { 0 };
+  uint8_t* cache_filename = NULL;
+
+  // load time profile of the current track and all tracks
+  PROFILE prof = { 0 };
+  PROFILE prof_total = { 0 };
+
   // credit
   printf("S44BGP.X - 16bit PCM background player for Mercury-UNIT version " PROGRAM_VERSION " by tantan\n");
 
@@ -265,12 +294,20 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
   // parse command lines
   for (int16_t i = 1; i < argc; i++) {
     if (argv[i][0] == '-' && strlen(argv[i]) >= 2) {
-      if (argv[i][1] == 'v') {
+      if (stricmp(argv[i], "-stat") == 0) {
+        stat_mode = 1;
+      } else if (stricmp(argv[i], "-bench") == 0) {
+        kernel_bench_mode = 1;
+      } else if (stricmp(argv[i], "-trace") == 0) {
+        trace_mode = 1;
+      } else if (argv[i][1] == 'v') {
         pcm_volume = atoi(argv[i]+2);
         if (pcm_volume < 1 || pcm_volume > 12 || strlen(argv[i]) < 3) {
           show_help_message();
           goto exit;
         }
+      } else if (argv[i][1] == 'n') {
+        auto_volume = 1;
       } else if (argv[i][1] == 'r') {
         remove_mode = 1;
       } else if (argv[i][1] == '2') {
@@ -279,11 +316,39 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
         pcm_half_bit = 1;
       } else if (argv[i][1] == 'm') {
         pcm_channels = 1;
+      } else if (argv[i][1] == 'a') {
+        pcm_adpcm = 1;
       } else if (argv[i][1] == 's') {
         shuffle_mode = 1;
-        srand(_PSP);
+        g_rand_seed = _PSP;
+      } else if (argv[i][1] == 'e') {
+        key_hook = 1;
+      } else if (argv[i][1] == 'z') {
+        silence_mode = 1;
       } else if (argv[i][1] == 'q') {
         quiet_mode = 1;
+      } else if (argv[i][1] == 'b') {
+        bench_mode = 1;
+      } else if (argv[i][1] == 'P') {
+        profile_mode = argv[i][2] == 't' ? 2 : 1;
+      } else if (argv[i][1] == 't') {
+        resident_sec = atoi(argv[i]+2);
+        if (resident_sec < STREAM_MIN_HEAD_SEC || resident_sec > STREAM_MAX_HEAD_SEC) {
+          show_help_message();
+          goto exit;
+        }
+      } else if (argv[i][1] == 'k') {
+        track_cache_mb = atoi(argv[i]+2);
+        if (track_cache_mb < 1 || track_cache_mb > TRACKCACHE_MAX_MB) {
+          show_help_message();
+          goto exit;
+        }
+      } else if (argv[i][1] == 'x') {
+        crossfade_sec = atoi(argv[i]+2);
+        if (crossfade_sec < 1 || crossfade_sec > MAX_CROSSFADE_SEC) {
+          show_help_message();
+          goto exit;
+        }
       } else if (argv[i][1] == 'i' && i+1 < argc) {
 
         // indirect file
@@ -306,26 +371,44 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
               goto exit;
             }
  
+            // per track options (,v<n> volume, ,t<n> resident seconds, ,l<start>-<end> loop frames, ,r<n> loop repetitions)
             int16_t volume = pcm_volume;
-            for (int16_t i = 0; i < MAX_PATH_LEN; i++) {
-              if (line[i] == ',') {
-                if (i+2 < MAX_PATH_LEN && line[i+1] == 'v') {
-                  int16_t v = atoi(line+i+2);
+            int16_t sec = resident_sec;
+            uint8_t* opt = strchr(line, ',');
+            if (opt != NULL) {
+              *opt = '\0';
+              do {
+                opt++;
+                if (opt[0] == 'v') {
+                  int16_t v = atoi(opt+1);
                   if (v >= 1 && v <= 12) volume = v;
+                } else if (opt[0] == 't') {
+                  int16_t t = atoi(opt+1);
+                  if (t >= STREAM_MIN_HEAD_SEC && t <= STREAM_MAX_HEAD_SEC) sec = t;
+                } else if (opt[0] == 'l') {
+                  uint8_t* end = strchr(opt, '-');
+                  uint8_t* next = strchr(opt, ',');
+                  if (end != NULL && (next == NULL || end < next)) {
+                    loop_frames[ num_music ][0] = atoi(opt+1);
+                    loop_frames[ num_music ][1] = atoi(end+1);
+                  }
+                } else if (opt[0] == 'r') {
+                  int16_t r = atoi(opt+1);
+                  if (r >= 0 && r <= LOOP_MAX_COUNT) loop_counts[ num_music ] = r;
                 }
-                line[i] = '\0';
-                break;
-              }
+              } while ((opt = strchr(opt, ',')) != NULL);
             }
      
             uint8_t* pcm_filename = line;
             uint8_t* pcm_fileext = pcm_filename + strlen(pcm_filename) - 4;
-            if (stricmp(pcm_fileext, ".s44") != 0 && stricmp(pcm_fileext, ".a44")) {
-              printf("error: not .s44/.a44 data file. (%s)\n", pcm_filename);
+            if (stricmp(pcm_fileext, ".s44") != 0 && stricmp(pcm_fileext, ".a44") != 0 &&
+                stricmp(pcm_fileext, ".z44") != 0 && stricmp(pcm_fileext, ".wav") != 0) {
+              printf("error: not .s44/.a44/.z44/.wav data file. (%s)\n", pcm_filename);
               goto exit;
             }
             strcpy(g_pcm_music[ num_music ].file_name, pcm_filename);
             g_pcm_music[ num_music ].volume = volume;
+            resident_secs[ num_music ] = sec;
             num_music++;
 
           }
@@ -335,6 +418,9 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
 
         }
         i++;
+      } else if (argv[i][1] == 'c' && i+1 < argc) {
+        cache_filename = argv[i+1];
+        i++;
       } else if (argv[i][1] == 'h') {
         show_help_message();
         goto exit;
@@ -355,12 +441,14 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
       }
       
       uint8_t* pcm_fileext = pcm_filename + strlen(pcm_filename) - 4;
-      if (stricmp(pcm_fileext, ".s44") != 0 && stricmp(pcm_fileext, ".a44")) {
-        printf("error: not .s44/.a44 data file. (%s)\n", pcm_filename);
+      if (stricmp(pcm_fileext, ".s44") != 0 && stricmp(pcm_fileext, ".a44") != 0 &&
+          stricmp(pcm_fileext, ".z44") != 0 && stricmp(pcm_fileext, ".wav") != 0) {
+        printf("error: not .s44/.a44/.z44/.wav data file. (%s)\n", pcm_filename);
         goto exit;
       }
       strcpy(g_pcm_music[ num_music ].file_name, pcm_filename);
       g_pcm_music[ num_music ].volume = pcm_volume;
+      resident_secs[ num_music ] = resident_sec;
       num_music++;
     }
   }
@@ -387,21 +475,49 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
       TIMERDST(0,0,0);
 #endif
 
-      // release allocated high memory buffers
-      uint8_t* mem_end = (uint8_t*)B_LPEEK((uint32_t*)(pdp - 8));
-      uint8_t* check_addr = (uint8_t*)(pdp + 256);
-      int16_t num_free = 0;
-      while (check_addr < mem_end) {
-        if (memcmp(check_addr, EYE_CATCH, EYE_CATCH_LEN) == 0) {
-          //printf("found eye catch at %X\n", check_addr);
-          uint32_t himem_addr = B_LPEEK((uint32_t*)(check_addr + EYE_CATCH_LEN));
-          if (himem_addr != 0) {
-            himem_free((void*)himem_addr, 1);
-          }
-          num_free++;
+      // release the keyboard hook, unless another program hooked the vector after us
+      uint32_t resident_entry = (uint32_t)(pdp + ((uint8_t*)keyhook_entry - (uint8_t*)GETPDB()));
+      void** resident_old_vector = (void**)(pdp + ((uint8_t*)&keyhook_old_vector - (uint8_t*)GETPDB()));
+      if (B_LPEEK((uint32_t*)(KEYHOOK_VECTOR * 4)) == resident_entry) {
+        INTVCS(KEYHOOK_VECTOR, *resident_old_vector);
+      } else if (*resident_old_vector != NULL) {
+        printf("warn: keyboard vector was hooked by another program, it is left as it is.\n");
+      }
+
+      // release the disk IOCS hooks in the same way
+      uint16_t* resident_calls = (uint16_t*)(pdp + ((uint8_t*)diskhook_calls - (uint8_t*)GETPDB()));
+      void** resident_entries = (void**)(pdp + ((uint8_t*)diskhook_entries - (uint8_t*)GETPDB()));
+      void** resident_old_vectors = (void**)(pdp + ((uint8_t*)diskhook_old_vectors - (uint8_t*)GETPDB()));
+      for (int16_t i = 0; i < DISKHOOK_CALLS; i++) {
+        if (resident_old_vectors[i] == NULL) continue;
+        if (B_LPEEK((uint32_t*)DISKHOOK_TABLE(resident_calls[i])) == (uint32_t)resident_entries[i]) {
+          INTVCS(DISKHOOK_VECTOR(resident_calls[i]), resident_old_vectors[i]);
+        } else {
+          printf("warn: IOCS call $%02x was hooked by another program, it is left as it is.\n", resident_calls[i]);
         }
-        check_addr += 2;
-        if (num_free >= MAX_MUSIC) break;
+      }
+
+      // release the buffers of the player state and the state block itself
+      RESIDENT_STATE* resident = get_resident_state(pdp);
+      if (resident != NULL) {
+        for (int16_t i = 0; i < MAX_MUSIC; i++) {
+          PCM_MUSIC* pcm = &(resident->pcm_music[i]);
+          // repeated entries share the buffers of the first one, free them only once
+          if (pcm->shared) continue;
+          if (pcm->buffer != NULL) himem_free(pcm->buffer, 1);
+          // KMD events, stream sources and links are in main memory blocks owned by the resident process
+          if (pcm->kmd.events != NULL) himem_free(pcm->kmd.events, 0);
+          if (pcm->stream != NULL) himem_free(pcm->stream, 0);
+          if (pcm->links != NULL) himem_free(pcm->links, 0);
+        }
+        // files kept open for the refills belong to the resident process
+        refill_close(&(resident->refill));
+        if (resident->stream.ring != NULL) himem_free(resident->stream.ring, 1);
+        if (resident->zero_block != NULL) himem_free(resident->zero_block, 1);
+        if (resident->track_cache.arena != NULL) himem_free(resident->track_cache.arena, 1);
+        himem_free(resident, 0);
+      } else {
+        printf("warn: running " PROGRAM_NAME " has no player state, its buffers are left allocated. (different version?)\n");
       }
 
       // release program memory itself
@@ -424,6 +540,100 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
     goto exit;
   }
 
+  // show interrupt handler statistics of running s44bgp
+  if (stat_mode) {
+    if (pdp != NULL) {
+
+      RESIDENT_STATE* resident = get_resident_state(pdp);
+      ISR_STAT* resident_stat = resident != NULL ? &(resident->isr_stat) : NULL;
+      if (resident_stat == NULL || memcmp(resident_stat->eye_catch, STAT_EYE_CATCH, EYE_CATCH_LEN) != 0) {
+        printf("error: running " PROGRAM_NAME " has no statistics. (different version?)\n");
+        rc = 1;
+        goto exit;
+      }
+
+      ISR_STAT stat;
+      memcpy(&stat, resident_stat, sizeof(ISR_STAT));
+      uint32_t avg_usec = stat.calls > 0 ? stat.total_usec / stat.calls : 0;
+      printf("interrupt handler calls: %d\n", stat.calls);
+      printf("interrupt handler duration: avg %d [us] / max %d [us] (50us resolution)\n", avg_usec, stat.max_usec);
+      printf("  stop checks : %d\n", stat.stop_checks);
+      printf("  next music  : %d\n", stat.next_music);
+      printf("  interrupted : %d\n", stat.interrupted);
+      printf("  resumed     : %d\n", stat.resumed);
+      printf("  aborted     : %d\n", stat.aborted);
+      printf("  key checks  : %d\n", stat.key_checks);
+      printf("  pause       : %d\n", stat.pause);
+      printf("  resume      : %d\n", stat.resume);
+      printf("  skip        : %d\n", stat.skip);
+      printf("  kmd events  : %d\n", stat.kmd_events);
+      printf("  crossfades  : %d\n", stat.crossfades);
+      printf("  key events  : %d\n", stat.key_events);
+      printf("  overruns    : %d (during disk refills, not in the calls above)\n", stat.overruns);
+
+      STREAM_PLAYER* resident_stream = &(resident->stream);
+      if (memcmp(resident_stream->eye_catch, STREAM_EYE_CATCH, STREAM_EYE_CATCH_LEN) == 0) {
+        printf("stream refills: %d blocks, %d underruns\n", resident_stream->refills, resident_stream->underruns);
+      }
+
+      REFILL* rf = &(resident->refill);
+      printf("disk reads: %d reads, %d opens, %d seeks, %d deferred while DOS or the disk was busy\n",
+        rf->reads, rf->opens, rf->seeks, rf->deferred);
+
+      TRACK_CACHE* resident_track_cache = &(resident->track_cache);
+      if (memcmp(resident_track_cache->eye_catch, TRACKCACHE_EYE_CATCH, TRACKCACHE_EYE_CATCH_LEN) == 0) {
+        TRACK_CACHE* tc = resident_track_cache;
+        uint32_t plays = tc->hits + tc->misses;
+        printf("track cache: %d slots of %d [KB], %d hits / %d plays (%d%%), %d underruns\n",
+          tc->num_slots, tc->slot_bytes / 1024, tc->hits, plays, plays > 0 ? tc->hits * 100 / plays : 0, tc->underruns);
+        printf("track cache loads: %d, load time avg %d [ms] / max %d [ms]\n",
+          tc->loads, tc->loads > 0 ? tc->load_msec_total / tc->loads : 0, tc->load_msec_max);
+      }
+
+      rc = 0;
+
+    } else {
+      printf(PROGRAM_NAME " is not running.\n");
+      rc = 1;
+    }
+
+    goto exit;
+  }
+
+  // show the playback event trace of running s44bgp
+  if (trace_mode) {
+    if (pdp != NULL) {
+
+      // the ring and the interrupt clock are in the player state, see -stat
+      RESIDENT_STATE* resident = get_resident_state(pdp);
+      TRACE_RING* resident_trace = resident != NULL ? &(resident->trace) : NULL;
+      if (resident_trace == NULL || memcmp(resident_trace->eye_catch, TRACE_EYE_CATCH, TRACE_EYE_CATCH_LEN) != 0) {
+        printf("error: running " PROGRAM_NAME " has no trace. (different version?)\n");
+        rc = 1;
+        goto exit;
+      }
+
+      // a copy taken at once, the handler goes on recording
+      static TRACE_RING trace;
+      memcpy(&trace, resident_trace, sizeof(TRACE_RING));
+      trace_dump(&trace, resident->clock_msec, (uint32_t)GETTIM2());
+
+      rc = 0;
+
+    } else {
+      printf(PROGRAM_NAME " is not running.\n");
+      rc = 1;
+    }
+
+    goto exit;
+  }
+
+  // conversion kernel benchmark of all CPU variants and the ADPCM decoder
+  if (kernel_bench_mode) {
+    rc = convert_benchmark(convert_get_mpu_type()) == 0 && decode_benchmark() == 0 ? 0 : 1;
+    goto exit;
+  }
+
   if (num_music == 0) {
     show_help_message();
     goto exit;
@@ -460,65 +670,330 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
     goto exit;
   }
 
+  // ADPCM mode is always 15.6kHz mono
+  if (pcm_adpcm) {
+    pcm_half_rate = 0;
+    pcm_half_bit = 0;
+    pcm_channels = 1;
+  }
+
   // information
-  printf("PCM frequency: %d [Hz]\n", pcm_half_rate ? 22050 : 44100);
+  printf("PCM frequency: %d [Hz]\n", pcm_adpcm ? MSM6258_SAMPLE_RATE : pcm_half_rate ? 22050 : 44100);
   printf("PCM channels: %s\n", pcm_channels == 1 ? "mono" : "stereo");
-  printf("PCM bits: %d\n", pcm_half_bit ? 8 : 16);
+  printf("PCM bits: %d%s\n", pcm_adpcm ? 4 : pcm_half_bit ? 8 : 16, pcm_adpcm ? " (ADPCM)" : "");
+
+  // conversion kernels built for this CPU
+  int16_t mpu_type = convert_get_mpu_type();
+  CONVERT_KERNEL* kernel = convert_select(mpu_type);
+  int16_t convert_mode = (pcm_channels == 1 ? CONVERT_MONO : 0) | (pcm_half_rate ? CONVERT_HALF_RATE : 0);
+  printf("MPU: 680%d0 (conversion kernels for %s)\n", mpu_type, kernel->name);
   printf("--\n");
   printf("Available high memory: %d [KB]\n", himem_getsize(1) / 1024);
 
+  // metadata cache lookup and high memory plan before any audio data is read
+  uint16_t conv_mode = (pcm_channels == 1 ? CACHE_MODE_MONO : 0) | (pcm_half_rate ? CACHE_MODE_HALF_RATE : 0) |
+                       (pcm_half_bit ? CACHE_MODE_HALF_BIT : 0) | (pcm_adpcm ? CACHE_MODE_ADPCM : 0);
+  if (cache_filename != NULL) {
+    if (cache_open(&cache, cache_filename) != 0) {
+      printf("error: metadata cache allocation error. (out of memory?)\n");
+      goto exit;
+    }
+    size_t planned_bytes = 0;
+    int16_t num_cached = 0;
+    for (int16_t i = 0; i < num_music; i++) {
+      CACHE_ENTRY* e = cache_lookup(&cache, g_pcm_music[i].file_name, conv_mode);
+      cached_entries[i] = e;
+      if (e != NULL) {
+        if (find_music(i, resident_secs, loop_frames, loop_counts) >= 0) continue;
+        if (track_cache_mb > 0 && e->format == CACHE_FORMAT_S44 && conv_mode == 0) continue;
+        if (loop_frames[i][1] > 0) continue;
+        planned_bytes += e->buffer_bytes;
+        num_cached++;
+      }
+    }
+    printf("Metadata cache: %d/%d tracks valid, %d [KB] of high memory planned\n", num_cached, num_music, planned_bytes / 1024);
+    if (planned_bytes > himem_getsize(1)) {
+      printf("error: not enough high memory for the playlist. (%d [KB] required)\n", planned_bytes / 1024);
+      goto exit;
+    }
+  }
+
   // load pcm data to high memory
   for (int16_t i = 0; i < num_music; i++) {
 
     PCM_MUSIC* pcm = &(g_pcm_music[i]);
 
+    // the same file was already loaded in the same conversion mode with the same options, share its buffer and KMD events
+    int16_t shared_index = find_music(i, resident_secs, loop_frames, loop_counts);
+    if (shared_index >= 0) {
+      PCM_MUSIC* src = &(g_pcm_music[ shared_index ]);
+      pcm->buffer = src->buffer;
+      pcm->buffer_bytes = src->buffer_bytes;
+      pcm->total_time_msec = src->total_time_msec;
+      pcm->kmd = src->kmd;
+      pcm->stream = src->stream;
+      pcm->rms = src->rms;
+      pcm->peak = src->peak;
+      pcm->cached = src->cached;
+      pcm->loop_start = src->loop_start;
+      pcm->loop_end = src->loop_end;
+      pcm->loop_cut_msec = src->loop_cut_msec;
+      pcm->links = src->links;
+      pcm->shared = 1;
+      if (auto_volume) {
+        pcm->volume = loudness_get_volume(pcm->rms, pcm->peak, pcm->volume);
+      }
+      printf("Shared %s with entry %d. (volume %d)\n", pcm->file_name, shared_index + 1, pcm->volume);
+      continue;
+    }
+
     // ym2608 adpcm format?
     uint8_t* pcm_filename = pcm->file_name;
     uint8_t* pcm_fileext = pcm_filename + strlen(pcm_filename) - 4;
     int16_t ym2608 = stricmp(pcm_fileext, ".a44") == 0 ? 1 : 0;
 
-    // kmd
-    static uint8_t kmd_filename[ MAX_PATH_LEN ];
-    strcpy(kmd_filename, pcm_filename);
-    strcpy(kmd_filename + strlen(kmd_filename) - 4, ".kmd");
-    fp = fopen(kmd_filename, "r");
-    if (fp != NULL) {
-      if (kmd_init(&(pcm->kmd), fp) != 0) {
-        printf("warn: KMD file read error. (%s)\n", kmd_filename);
+    // wav format?
+    int16_t wav = stricmp(pcm_fileext, ".wav") == 0 ? 1 : 0;
+    WAV_HANDLE wav_reader = { 0 };
+
+    // loudness measured in the load loop
+    LOUDNESS loudness = { 0 };
+
+    // z44 (lossless compressed s44) format?
+    int16_t z44 = stricmp(pcm_fileext, ".z44") == 0 ? 1 : 0;
+
+    // kmd (a valid metadata cache entry tells there is no KMD file or gives its tags when it has no events)
+    profile_reset(&prof);
+    uint32_t kmd_start_time = profile_get_usec();
+    CACHE_ENTRY* cached = cached_entries[i];
+    int16_t kmd_events = -1;
+    if (cached != NULL && cached->kmd_events <= 0) {
+      kmd_init(&(pcm->kmd), NULL);
+      strcpy(pcm->kmd.tag_title, cached->tag_title);
+      strcpy(pcm->kmd.tag_artist, cached->tag_artist);
+      strcpy(pcm->kmd.tag_album, cached->tag_album);
+      kmd_events = cached->kmd_events;
+    } else {
+      static uint8_t kmd_filename[ MAX_PATH_LEN ];
+      strcpy(kmd_filename, pcm_filename);
+      strcpy(kmd_filename + strlen(kmd_filename) - 4, ".kmd");
+      fp = fopen(kmd_filename, "r");
+      if (fp != NULL) {
+        if (kmd_init(&(pcm->kmd), fp) != 0) {
+          printf("warn: KMD file read error. (%s)\n", kmd_filename);
+        }
+        kmd_events = pcm->kmd.num_events;
+        prof.bytes[ PROFILE_KMD ] = ftell(fp);
+        fclose(fp);
+        fp = NULL;      
       }
-      fclose(fp);
-      fp = NULL;      
     }
+    prof.usec[ PROFILE_KMD ] = profile_get_usec() - kmd_start_time;
 
-    // open a pcm file
-    fp = fopen(pcm_filename, "rb");
-    if (fp == NULL) {
+    // open a pcm file (the size of a valid metadata cache entry is used without probing)
+    uint32_t load_start_time = profile_get_usec();
+    if ((cached != NULL ? dosio_open_size(&pcm_io, pcm_filename, cached->file_bytes) : dosio_open(&pcm_io, pcm_filename)) != 0) {
       printf("error: file open error. (%s)\n", pcm_filename);
       goto exit;
     }
 
     // check data length in 16bit unit
-    fseek(fp, 0, SEEK_END);
-    size_t data_len = ftell(fp) / sizeof(int16_t);
-    fseek(fp, 0, SEEK_SET);
+    size_t data_len = 0;
+    if (wav) {
+      // parse RIFF header, the file pointer is left at the top of data chunk
+      if (wav_init(&wav_reader, &pcm_io, kernel) != 0) {
+        printf("error: wav header read error. (%s)\n", pcm_filename);
+        goto exit;
+      }
+      if (!wav_is_supported(&wav_reader)) {
+        printf("error: unsupported wav format. 16bit linear PCM/22.05-48kHz/mono or stereo is required. (%s)\n", pcm_filename);
+        goto exit;
+      }
+      data_len = wav_get_data_len(&wav_reader);
+    } else if (z44) {
+      // read header and block index, the file pointer is left at the first block
+      if (z44_init(&z44_reader, &pcm_io) != 0) {
+        printf("error: z44 header read error. (%s)\n", pcm_filename);
+        goto exit;
+      }
+      data_len = z44_get_data_len(&z44_reader);
+    } else {
+      data_len = dosio_get_size(&pcm_io) / sizeof(int16_t);
+    }
+
+    // every .a44 file is a new ADPCM stream
+    if (ym2608) {
+      ym2608_decode_reset(&ym2608_decode);
+    }
+
+    // header reads belong to the size probe stage
+    uint32_t probe_end_time = profile_get_usec();
+    uint32_t header_read_time = pcm_io.read_time;
+    size_t header_read_bytes = pcm_io.read_bytes;
+    uint32_t ym2608_decode_time = ym2608_decode.decode_time;
+    size_t ym2608_decode_bytes = ym2608_decode.decode_bytes;
+
+    // loop region of a raw .s44 in a PCM mode (the indirect file first, then the KMD tag),
+    // only the intro and one loop body are loaded (on even frames in half rate mode, they are the ones kept)
+    uint32_t loop_start = loop_frames[i][1] > 0 ? loop_frames[i][0] : pcm->kmd.loop_start;
+    uint32_t loop_end = loop_frames[i][1] > 0 ? loop_frames[i][1] : pcm->kmd.loop_end;
+    uint32_t loop_file_frames = data_len / 2;
+    uint32_t frame_bytes = (pcm_half_bit ? 1 : 2) * pcm_channels;
+    if (pcm_half_rate) {
+      loop_start &= ~0x01;
+      loop_end &= ~0x01;
+    }
+    if (loop_end > 0) {
+      if (wav || z44 || ym2608 || pcm_adpcm) {
+        printf("warn: loop region is supported for .s44 in PCM modes only, ignored. (%s)\n", pcm_filename);
+        loop_end = 0;
+      } else if (loop_start >= loop_end || loop_end > loop_file_frames || get_frames_msec(loop_end - loop_start) < LOOP_MIN_BODY_MSEC) {
+        printf("warn: loop region out of the file or shorter than %d sec, ignored. (%s)\n", LOOP_MIN_BODY_MSEC / 1000, pcm_filename);
+        loop_end = 0;
+      } else if (!loop_fits((loop_start >> pcm_half_rate) * frame_bytes, (loop_end >> pcm_half_rate) * frame_bytes)) {
+        printf("warn: loop region too long for the chain, ignored. (%s)\n", pcm_filename);
+        loop_end = 0;
+      } else {
+        data_len = loop_end * 2;
+      }
+    }
+
+    // sample rate conversion is required?
+    int32_t in_rate = wav ? wav_reader.sample_rate : 44100;
+    int32_t out_rate = pcm_adpcm ? MSM6258_SAMPLE_RATE : pcm_half_rate ? 22050 : 44100;
+    int16_t resample = (in_rate != 44100 || pcm_adpcm) ? 1 : 0;
+    if (resample && resample_init(&resampler, in_rate, out_rate) != 0) {
+      printf("error: resampler initialization error. (out of memory?)\n");
+      goto exit;
+    }
+
+    // data length in 44.1kHz 16bit stereo unit after sample rate conversion
+    size_t conv_len = in_rate != 44100 ? resample_get_length(data_len, in_rate, 44100) : data_len;
 
     // allocate high memory
-    size_t allocate_bytes = data_len * sizeof(int16_t) * (ym2608 ? 4 : 1) / (3 - pcm_channels) / (1 + pcm_half_rate) / (1 + pcm_half_bit);
-    pcm->buffer = himem_malloc(allocate_bytes, 1);
+    size_t allocate_bytes = pcm_adpcm ?
+      resample_get_length(conv_len * (ym2608 ? 4 : 1), 44100, MSM6258_SAMPLE_RATE) / 2 / 2 + 2 :
+      conv_len * sizeof(int16_t) * (ym2608 ? 4 : 1) / (3 - pcm_channels) / (1 + pcm_half_rate) / (1 + pcm_half_bit);
+
+    // raw .s44 played as 44.1kHz 16bit stereo can keep only the head resident and stream the tail from disk,
+    // it is also the fallback when the whole track does not fit
+    int16_t streamable = !wav && !z44 && !ym2608 && pcm_channels == 2 && !pcm_half_rate && !pcm_half_bit && !pcm_adpcm && loop_end == 0;
+
+    // total music time
+    pcm->total_time_msec = get_frames_msec(conv_len * (ym2608 ? 4 : 1) / 2);
+
+    // a looped track repeats the body as many times as the file does unless it is given (0: endless)
+    int16_t loop_count = 0;
+    if (loop_end > 0) {
+      uint32_t intro_msec = get_frames_msec(loop_start);
+      uint32_t body_msec = get_frames_msec(loop_end - loop_start);
+      loop_count = loop_counts[i] >= 0 ? loop_counts[i] : (loop_file_frames - loop_start) / (loop_end - loop_start);
+      pcm->loop_start = (loop_start >> pcm_half_rate) * frame_bytes;
+      pcm->loop_end = (loop_end >> pcm_half_rate) * frame_bytes;
+      pcm->total_time_msec = loop_count == 0 ? 0xffffffff : intro_msec + body_msec * loop_count;
+      pcm->loop_cut_msec = loop_count == 0 ? LOOP_NO_CUT : intro_msec + body_msec * (loop_count - 1) + body_msec / 2;
+    }
+
+    // in track cache mode such a track is only indexed here and loaded by the interrupt handler when it is due
+    if (streamable && track_cache_mb > 0) {
+      pcm->stream = himem_malloc(sizeof(PCM_STREAM), 0);
+      if (pcm->stream == NULL) {
+        printf("error: main memory allocation error. (out of memory?)\n");
+        goto exit;
+      }
+      if (stream_init(pcm->stream, pcm_filename, 0, data_len * sizeof(int16_t)) != 0) {
+        printf("error: full path name error. (%s)\n", pcm_filename);
+        goto exit;
+      }
+      dosio_close(&pcm_io);
+      pcm->cached = 1;
+      pcm->buffer_bytes = pcm->stream->tail_bytes;
+      if (pcm->buffer_bytes > track_slot_bytes) track_slot_bytes = pcm->buffer_bytes;
+      printf("Indexed %s (%d.%dsec) for the track cache.\n", pcm_filename, pcm->total_time_msec / 1000, pcm->total_time_msec / 100 % 10);
+      continue;
+    }
+    size_t load_len = data_len;
+    if (streamable && resident_secs[i] > 0) {
+      load_len = resident_secs[i] * STREAM_BYTES_PER_SEC / sizeof(int16_t);
+    }
+    pcm->buffer = load_len >= data_len ? himem_malloc(allocate_bytes, 1) : NULL;
+    if (pcm->buffer == NULL && streamable && load_len >= data_len) {
+      load_len = STREAM_DEFAULT_SEC * STREAM_BYTES_PER_SEC / sizeof(int16_t);
+      if (load_len < data_len) {
+        printf("warn: not enough high memory for the whole track, streaming after the first %d sec. (%s)\n", STREAM_DEFAULT_SEC, pcm_filename);
+      }
+    }
+    if (load_len < data_len) {
+      pcm->stream = himem_malloc(sizeof(PCM_STREAM), 0);
+      if (pcm->stream == NULL || stream_open(&g_stream) != 0) {
+        printf("error: stream buffer allocation error. (out of memory?)\n");
+        goto exit;
+      }
+      if (stream_init(pcm->stream, pcm_filename, load_len * sizeof(int16_t), (data_len - load_len) * sizeof(int16_t)) != 0) {
+        printf("error: full path name error. (%s)\n", pcm_filename);
+        goto exit;
+      }
+      allocate_bytes = load_len * sizeof(int16_t);
+      pcm->buffer = himem_malloc(allocate_bytes, 1);
+    } else {
+      load_len = data_len;
+    }
     if (pcm->buffer == NULL) {
       printf("error: high memory allocation error. (out of memory?)\n");
       goto exit;
     }
 
-    // total music time
-    pcm->total_time_msec = (uint32_t)(data_len * 1000.0 * (ym2608 ? 4 : 1 ) / 44100.0 / 2.0);
-
     // load data to high memory
-    if (!ym2608) {
+    if (pcm_adpcm) {
+
+      // ADPCM (.s44 / .z44 / .wav / .a44)
+
+      // stereo to mono, down sampling to 15.6kHz and MSM6258 ADPCM encoding
+      msm6258_encode_init(&msm6258_encode);
+      size_t read_len = 0;
+      uint8_t* gma = (uint8_t*)pcm->buffer;
+      do {
+
+        if (B_SFTSNS() & 0x01) {
+          goto cancel;
+        }
+
+        size_t len = 0;
+        int16_t* src_buffer = fread_buffer;
+        size_t src_len = 0;
+        if (ym2608) {
+          len = dosio_read(&pcm_io, fread_buffer, YM2608_READ_LEN * sizeof(int16_t)) / sizeof(int16_t);
+          if (len == 0) break;
+          src_buffer = ym2608_decode.decode_buffer;
+          src_len = ym2608_decode_exec(&ym2608_decode, (uint8_t*)fread_buffer, len * sizeof(int16_t));
+        } else {
+          len = wav ? wav_read(&wav_reader, &pcm_io, fread_buffer, fread_buffer, FREAD_BUFFER_LEN) :
+                z44 ? z44_read(&z44_reader, &pcm_io, (uint8_t*)(fread_buffer + FREAD_BUFFER_LEN), FREAD_BUFFER_LEN * sizeof(int16_t), fread_buffer, FREAD_BUFFER_LEN) :
+                      dosio_read(&pcm_io, fread_buffer, FREAD_ALIGNED_LEN * sizeof(int16_t)) / sizeof(int16_t);
+          if (len == 0) break;
+          src_len = len;
+        }
+
+        // down sampling into the latter half of the staging buffer
+        src_len = resample_exec(&resampler, src_buffer, src_len, fread_buffer + FREAD_BUFFER_LEN);
+        loudness_update(&loudness, fread_buffer + FREAD_BUFFER_LEN, src_len);
+        gma += msm6258_encode_exec(&msm6258_encode, fread_buffer + FREAD_BUFFER_LEN, src_len, 2, gma);
+
+        read_len += len;
+        show_progress(pcm_filename, read_len, data_len);
 
-      // .s44
+      } while (read_len < data_len);
 
-      if (pcm_channels == 2 && pcm_half_rate == 0 && pcm_half_bit == 0) {
+      gma += msm6258_encode_flush(&msm6258_encode, gma);
+
+      // do not play the allocation margin
+      allocate_bytes = gma - (uint8_t*)pcm->buffer;
+
+    } else if (!ym2608) {
+
+      // .s44 / .z44 / .wav
+
+      if (pcm_channels == 2 && pcm_half_rate == 0 && pcm_half_bit == 0 && resample == 0) {
 
         // 16bit through
 
@@ -529,15 +1004,23 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
             goto cancel;
           }
 
-          size_t len = fread(fread_buffer, sizeof(int16_t), FREAD_BUFFER_LEN, fp);
+          // a streamed track reads its head only
+          size_t s44_len = load_len - read_len < FREAD_ALIGNED_LEN ? load_len - read_len : FREAD_ALIGNED_LEN;
+          size_t len = wav ? wav_read(&wav_reader, &pcm_io, fread_buffer, pcm->buffer + read_len, FREAD_BUFFER_LEN) :
+                       z44 ? z44_read(&z44_reader, &pcm_io, (uint8_t*)fread_buffer, FREAD_BUFFER_LEN * sizeof(int16_t) * 2, pcm->buffer + read_len, FREAD_BUFFER_LEN) :
+                             dosio_read(&pcm_io, fread_buffer, s44_len * sizeof(int16_t)) / sizeof(int16_t);
           if (len == 0) break;
 
-          memcpy(pcm->buffer + read_len, fread_buffer, len * sizeof(int16_t));
+          // wav data are byte swapped and z44 data are decoded directly into high memory, no other conversion is needed
+          if (!wav && !z44) {
+            memcpy(pcm->buffer + read_len, fread_buffer, len * sizeof(int16_t));
+          }
+          loudness_update(&loudness, pcm->buffer + read_len, len);
 
           read_len += len;
-          printf("\rLoading %s (%4.2f%%) ... [SHIFT] key to cancel.", pcm_filename, read_len * 100.0 / data_len);
+          show_progress(pcm_filename, read_len, load_len);
 
-        } while (read_len < data_len);
+        } while (read_len < load_len);
 
       } else if (pcm_half_bit == 0) {
 
@@ -553,29 +1036,26 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
             goto cancel;
           }
 
-          size_t len = fread(fread_buffer, sizeof(int16_t), FREAD_BUFFER_LEN, fp);
+          size_t len = wav ? wav_read(&wav_reader, &pcm_io, fread_buffer, fread_buffer, resample ? FREAD_BUFFER_LEN / 2 : FREAD_BUFFER_LEN) :
+                       z44 ? z44_read(&z44_reader, &pcm_io, (uint8_t*)(fread_buffer + FREAD_BUFFER_LEN), FREAD_BUFFER_LEN * sizeof(int16_t), fread_buffer, FREAD_BUFFER_LEN) :
+                             dosio_read(&pcm_io, fread_buffer, (data_len - read_len < FREAD_ALIGNED_LEN ? data_len - read_len : FREAD_ALIGNED_LEN) * sizeof(int16_t)) / sizeof(int16_t);
           if (len == 0) break;
 
-          for (size_t j = 0; j < len/2; j++) {
-
-            // down sampling in half rate mode
-            num_samples++;
-            if (pcm_half_rate && !(num_samples & 0x01)) continue;
-
-            if (pcm_channels == 1) {
-              // stereo to mono
-              gma[0] = ( fread_buffer[ j * 2 + 0 ] + fread_buffer[ j * 2 + 1 ] ) / 2;
-              gma++;
-            } else {
-              // stereo
-              gma[0] = fread_buffer[ j * 2 + 0 ];
-              gma[1] = fread_buffer[ j * 2 + 1 ];
-              gma += 2;
-            }
+          // sample rate conversion into the latter half of the staging buffer (up to x2)
+          int16_t* src_buffer = fread_buffer;
+          size_t src_len = len;
+          if (resample) {
+            src_buffer = fread_buffer + FREAD_BUFFER_LEN;
+            src_len = resample_exec(&resampler, fread_buffer, len, src_buffer);
           }
 
+          loudness_update(&loudness, src_buffer, src_len);
+
+          // down sampling in half rate mode (the resampler already did it)
+          gma += kernel->to_16bit(gma, src_buffer, src_len / 2, resample ? convert_mode & ~CONVERT_HALF_RATE : convert_mode, &num_samples);
+
           read_len += len;
-          printf("\rLoading %s (%4.2f%%) ... [SHIFT] key to cancel.", pcm_filename, read_len * 100.0 / data_len);
+          show_progress(pcm_filename, read_len, data_len);
 
         } while (read_len < data_len);
 
@@ -593,29 +1073,26 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
             goto cancel;
           }
 
-          size_t len = fread(fread_buffer, sizeof(int16_t), FREAD_BUFFER_LEN, fp);
+          size_t len = wav ? wav_read(&wav_reader, &pcm_io, fread_buffer, fread_buffer, resample ? FREAD_BUFFER_LEN / 2 : FREAD_BUFFER_LEN) :
+                       z44 ? z44_read(&z44_reader, &pcm_io, (uint8_t*)(fread_buffer + FREAD_BUFFER_LEN), FREAD_BUFFER_LEN * sizeof(int16_t), fread_buffer, FREAD_BUFFER_LEN) :
+                             dosio_read(&pcm_io, fread_buffer, (data_len - read_len < FREAD_ALIGNED_LEN ? data_len - read_len : FREAD_ALIGNED_LEN) * sizeof(int16_t)) / sizeof(int16_t);
           if (len == 0) break;
 
-          for (size_t j = 0; j < len/2; j++) {
-
-            // down sampling in half rate mode
-            num_samples++;
-            if (pcm_half_rate && !(num_samples & 0x01)) continue;
-
-            if (pcm_channels == 1) {
-              // stereo to mono
-              gma[0] = ( fread_buffer[ j * 2 + 0 ] + fread_buffer[ j * 2 + 1 ] ) / 2 / 256;
-              gma++;
-            } else {
-              // stereo
-              gma[0] = fread_buffer[ j * 2 + 0 ] / 256;
-              gma[1] = fread_buffer[ j * 2 + 1 ] / 256;
-              gma += 2;
-            }
+          // sample rate conversion into the latter half of the staging buffer (up to x2)
+          int16_t* src_buffer = fread_buffer;
+          size_t src_len = len;
+          if (resample) {
+            src_buffer = fread_buffer + FREAD_BUFFER_LEN;
+            src_len = resample_exec(&resampler, fread_buffer, len, src_buffer);
           }
 
+          loudness_update(&loudness, src_buffer, src_len);
+
+          // down sampling in half rate mode (the resampler already did it)
+          gma += kernel->to_8bit(gma, src_buffer, src_len / 2, resample ? convert_mode & ~CONVERT_HALF_RATE : convert_mode, &num_samples);
+
           read_len += len;
-          printf("\rLoading %s (%4.2f%%) ... [SHIFT] key to cancel.", pcm_filename, read_len * 100.0 / data_len);
+          show_progress(pcm_filename, read_len, data_len);
 
         } while (read_len < data_len);
 
@@ -639,32 +1116,17 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
             goto cancel;
           }
 
-          size_t len = fread(fread_buffer, sizeof(int16_t), YM2608_DECODE_BUFFER_BYTES / 4 / sizeof(int16_t), fp);
+          size_t len = dosio_read(&pcm_io, fread_buffer, YM2608_READ_LEN * sizeof(int16_t)) / sizeof(int16_t);
           if (len == 0) break;
 
           size_t decode_len = ym2608_decode_exec(&ym2608_decode, (uint8_t*)fread_buffer, len * sizeof(int16_t));
+          loudness_update(&loudness, ym2608_decode.decode_buffer, decode_len);
 
-          for (size_t j = 0; j < decode_len/2; j++) {
-
-            // down sampling in half rate mode
-            num_samples++;
-            if (pcm_half_rate && !(num_samples & 0x01)) continue;
-
-            int16_t* decode_buffer = ym2608_decode.decode_buffer;
-            if (pcm_channels == 1) {
-              // stereo to mono
-              gma[0] = ( decode_buffer[ j * 2 + 0 ] + decode_buffer[ j * 2 + 1 ] ) / 2;
-              gma++;
-            } else {
-              // stereo
-              gma[0] = decode_buffer[ j * 2 + 0 ];
-              gma[1] = decode_buffer[ j * 2 + 1 ];
-              gma += 2;
-            }
-          }
+          // stereo to mono and/or down sampling in half rate mode
+          gma += kernel->to_16bit(gma, ym2608_decode.decode_buffer, decode_len / 2, convert_mode, &num_samples);
 
           read_len += len;
-          printf("\rLoading %s (%4.2f%%) ... [SHIFT] key to cancel.", pcm_filename, read_len * 100.0 / data_len);
+          show_progress(pcm_filename, read_len, data_len);
 
         } while (read_len < data_len);
 
@@ -682,32 +1144,17 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
             goto cancel;
           }
 
-          size_t len = fread(fread_buffer, sizeof(int16_t), YM2608_DECODE_BUFFER_BYTES / 4 / sizeof(int16_t), fp);
+          size_t len = dosio_read(&pcm_io, fread_buffer, YM2608_READ_LEN * sizeof(int16_t)) / sizeof(int16_t);
           if (len == 0) break;
 
           size_t decode_len = ym2608_decode_exec(&ym2608_decode, (uint8_t*)fread_buffer, len * sizeof(int16_t));
+          loudness_update(&loudness, ym2608_decode.decode_buffer, decode_len);
 
-          for (size_t j = 0; j < decode_len/2; j++) {
-
-            // down sampling in half rate mode
-            num_samples++;
-            if (pcm_half_rate && !(num_samples & 0x01)) continue;
-
-            int16_t* decode_buffer = ym2608_decode.decode_buffer;
-            if (pcm_channels == 1) {
-              // stereo to mono
-              gma[0] = ( decode_buffer[ j * 2 + 0 ] + decode_buffer[ j * 2 + 1 ] ) / 2 / 256;
-              gma++;
-            } else {
-              // stereo
-              gma[0] = decode_buffer[ j * 2 + 0 ] / 256;
-              gma[1] = decode_buffer[ j * 2 + 1 ] / 256;
-              gma += 2;
-            }
-          }
+          // stereo to mono and/or down sampling in half rate mode
+          gma += kernel->to_8bit(gma, ym2608_decode.decode_buffer, decode_len / 2, convert_mode, &num_samples);
 
           read_len += len;
-          printf("\rLoading %s (%4.2f%%) ... [SHIFT] key to cancel.", pcm_filename, read_len * 100.0 / data_len);
+          show_progress(pcm_filename, read_len, data_len);
 
         } while (read_len < data_len);
 
@@ -715,14 +1162,155 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
 
     }
 
-    fclose(fp);
-    fp = NULL;
+    uint32_t load_end_time = profile_get_usec();
+    dosio_close(&pcm_io);
+
+    resample_close(&resampler);
+    z44_close(&z44_reader);
 
     pcm->buffer_bytes = allocate_bytes;
 
-    printf("\rLoaded %s (%3.1fsec) into high memory.\x1b[K\n", pcm_filename, pcm->total_time_msec / 1000.0);
+    // a streamed track is measured by its resident head
+    pcm->rms = loudness_get_rms(&loudness);
+    pcm->peak = loudness.peak;
+    if (auto_volume) {
+      pcm->volume = loudness_get_volume(pcm->rms, pcm->peak, pcm->volume);
+    }
+
+    // update metadata cache (entries are of whole files)
+    if (cache_filename != NULL && pcm->loop_end == 0) {
+      // zero filled with the padding, entries are compared as a whole
+      CACHE_ENTRY entry;
+      memset(&entry, 0, sizeof(CACHE_ENTRY));
+      strcpy(entry.file_name, pcm_filename);
+      entry.conv_mode = conv_mode;
+      entry.format = ym2608 ? CACHE_FORMAT_A44 : z44 ? CACHE_FORMAT_Z44 : wav ? CACHE_FORMAT_WAV : CACHE_FORMAT_S44;
+      entry.sample_rate = in_rate;
+      entry.buffer_bytes = allocate_bytes;
+      entry.total_time_msec = pcm->total_time_msec;
+      strcpy(entry.tag_title, pcm->kmd.tag_title);
+      strcpy(entry.tag_artist, pcm->kmd.tag_artist);
+      strcpy(entry.tag_album, pcm->kmd.tag_album);
+      entry.kmd_events = kmd_events;
+      cache_update(&cache, &entry, cached);
+    }
+
+    // head and tail silences are trimmed and long internal ones are played from the shared zero block
+    // (a track in high memory as a whole, its metadata cache entry is of the whole file)
+    static SILENCE_MAP silence_map;
+    uint32_t silence_saved = 0;
+    if (silence_mode && pcm->stream == NULL && pcm->loop_end == 0 && !pcm_adpcm) {
+      silence_scan(&silence_map, (uint8_t*)pcm->buffer, allocate_bytes, frame_bytes, pcm_half_bit ? 8 : 16,
+        out_rate * frame_bytes / 1000 * SILENCE_MIN_GAP_MSEC);
+      if (silence_map.num_gaps > 0 && g_zero_block == NULL) {
+        g_zero_block = himem_malloc(SILENCE_LINK_BYTES, 1);
+        if (g_zero_block == NULL) {
+          printf("error: high memory allocation error. (out of memory?)\n");
+          goto exit;
+        }
+        memset(g_zero_block, 0, SILENCE_LINK_BYTES);
+      }
+      if (silence_map.head_bytes + silence_map.tail_bytes + silence_map.gap_bytes > 0) {
+        uint32_t sound_bytes = silence_compact(&silence_map, (uint8_t*)pcm->buffer);
+        if (silence_map.num_gaps > 0) {
+          pcm->links = silence_make_links(&silence_map, (uint8_t*)pcm->buffer, sound_bytes, g_zero_block);
+          if (pcm->links == NULL) {
+            printf("error: main memory allocation error. (out of memory?)\n");
+            goto exit;
+          }
+        }
+        himem_resize(pcm->buffer, sound_bytes, 1);
+        silence_saved = allocate_bytes - sound_bytes;
+        allocate_bytes = sound_bytes;
+        pcm->buffer_bytes = sound_bytes;
+        uint32_t head_msec = get_frames_msec(silence_map.head_bytes / frame_bytes << pcm_half_rate);
+        uint32_t tail_msec = get_frames_msec(silence_map.tail_bytes / frame_bytes << pcm_half_rate);
+        pcm->total_time_msec = pcm->total_time_msec > head_msec + tail_msec ? pcm->total_time_msec - head_msec - tail_msec : 0;
+        kmd_shift(&(pcm->kmd), head_msec);
+      }
+    }
+
+    if (pcm->loop_end > 0) {
+      uint32_t intro_msec = get_frames_msec(loop_start);
+      uint32_t body_msec = get_frames_msec(loop_end - loop_start);
+      uint32_t file_bytes = (loop_file_frames >> pcm_half_rate) * frame_bytes;
+      printf("\rLoaded %s (intro %d.%dsec + loop %d.%dsec ", pcm_filename, intro_msec / 1000, intro_msec / 100 % 10, body_msec / 1000, body_msec / 100 % 10);
+      if (loop_count == 0) {
+        printf("endless");
+      } else {
+        printf("x %d", loop_count);
+      }
+      printf(") into high memory, %d [KB] less than the whole file.\x1b[K\n", (file_bytes - allocate_bytes) / 1024);
+    } else if (pcm->stream != NULL) {
+      uint32_t head_msec = allocate_bytes / (STREAM_BYTES_PER_SEC / 100) * 10;
+      printf("\rLoaded %s (%d.%dsec) into high memory, first %d.%dsec resident and the rest streamed from disk.\x1b[K\n",
+        pcm_filename, pcm->total_time_msec / 1000, pcm->total_time_msec / 100 % 10, head_msec / 1000, head_msec / 100 % 10);
+    } else {
+      printf("\rLoaded %s (%d.%dsec) into high memory.\x1b[K\n", pcm_filename, pcm->total_time_msec / 1000, pcm->total_time_msec / 100 % 10);
+    }
+    if (silence_saved > 0) {
+      uint32_t head_msec = get_frames_msec(silence_map.head_bytes / frame_bytes << pcm_half_rate);
+      uint32_t tail_msec = get_frames_msec(silence_map.tail_bytes / frame_bytes << pcm_half_rate);
+      uint32_t gap_msec = get_frames_msec(silence_map.gap_bytes / frame_bytes << pcm_half_rate);
+      printf("Silence: head %d.%dsec, tail %d.%dsec trimmed, %d gaps of %d.%dsec from the zero block, %d [KB] saved\n",
+        head_msec / 1000, head_msec / 100 % 10, tail_msec / 1000, tail_msec / 100 % 10,
+        silence_map.num_gaps, gap_msec / 1000, gap_msec / 100 % 10, silence_saved / 1024);
+    }
+    if (auto_volume) {
+      printf("Loudness: RMS %d, peak %d, volume %d\n", pcm->rms, pcm->peak, pcm->volume);
+    }
     printf("Available high memory: %d [KB]\n", himem_getsize(1) / 1024);
-  
+
+    // load throughput of I/O and conversion
+    if (bench_mode) {
+      uint32_t load_time = (load_end_time - load_start_time) / 1000;
+      uint32_t io_time = pcm_io.read_time / 1000 < load_time ? pcm_io.read_time / 1000 : load_time;
+      uint32_t conv_time = load_time - io_time;
+      uint32_t data_kb = pcm_io.read_bytes / 1024;
+      printf("I/O: %d [KB/s] (%d.%02d sec, %d reads) / conversion: %d [KB/s] (%d.%02d sec)\n",
+        data_kb * 1000 / (io_time > 0 ? io_time : 1), io_time / 1000, io_time / 10 % 100, pcm_io.read_calls,
+        data_kb * 1000 / (conv_time > 0 ? conv_time : 1), conv_time / 1000, conv_time / 10 % 100);
+    }
+
+    // load time profile (conversion is what is left after read and decode in the load loop)
+    if (profile_mode) {
+      prof.usec[ PROFILE_OPEN ] = pcm_io.open_time;
+      prof.usec[ PROFILE_PROBE ] = probe_end_time - load_start_time - pcm_io.open_time;
+      prof.bytes[ PROFILE_PROBE ] = header_read_bytes;
+      prof.usec[ PROFILE_READ ] = pcm_io.read_time - header_read_time;
+      prof.bytes[ PROFILE_READ ] = pcm_io.read_bytes - header_read_bytes;
+      prof.usec[ PROFILE_DECODE ] = ym2608_decode.decode_time - ym2608_decode_time + z44_reader.decode_time;
+      prof.bytes[ PROFILE_DECODE ] = ym2608_decode.decode_bytes - ym2608_decode_bytes + z44_reader.decode_bytes;
+      uint32_t loop_time = load_end_time - probe_end_time;
+      uint32_t other_time = prof.usec[ PROFILE_READ ] + prof.usec[ PROFILE_DECODE ];
+      prof.usec[ PROFILE_CONVERT ] = loop_time > other_time ? loop_time - other_time : 0;
+      prof.bytes[ PROFILE_CONVERT ] = allocate_bytes;
+      if (profile_mode == 2) {
+        profile_print_tsv(pcm_filename, &prof);
+        printf("checksum\t%s\t%d\t%08x\n", pcm_filename, allocate_bytes, profile_get_checksum(pcm->buffer, allocate_bytes));
+      } else {
+        printf("Profile: %s\n", pcm_filename);
+        profile_print(&prof);
+      }
+      profile_add(&prof_total, &prof);
+    }
+
+  }
+
+  // load time profile of all tracks
+  if (profile_mode == 2) {
+    profile_print_tsv("all", &prof_total);
+  } else if (profile_mode && num_music > 1) {
+    printf("Profile: all %d tracks\n", num_music);
+    profile_print(&prof_total);
+  }
+
+  // save metadata cache
+  if (cache_filename != NULL) {
+    if (cache_save(&cache, cache_filename) != 0) {
+      printf("warn: metadata cache write error. (%s)\n", cache_filename);
+    }
+    cache_close(&cache);
   }
 
   // reclaim file read buffer
@@ -735,18 +1323,31 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
   ym2608_decode_close(&ym2608_decode);
 
   // global counters
+  memset(&g_isr_stat, 0, sizeof(ISR_STAT));
+  memcpy(g_isr_stat.eye_catch, STAT_EYE_CATCH, EYE_CATCH_LEN);
+  trace_init(&g_trace);
   g_num_music = num_music;
   g_shuffle_mode = shuffle_mode;
   g_quiet_mode = quiet_mode;
+  g_key_hook = key_hook;
+  g_key_command = 0;
   g_paused = 0;
   g_elapsed_time = 0;
-  g_current_music = g_shuffle_mode ? rand() % g_num_music : 0;
+  g_channel = PCM8PP_CHANNEL;
+  g_fade_channel = -1;
+  g_fade_msec = crossfade_sec * 1000;
+  g_current_music = g_shuffle_mode ? resident_rand() % g_num_music : 0;
+  g_next_music = g_shuffle_mode ? resident_rand() % g_num_music : (g_current_music + 1) % g_num_music;
+  g_pending_mode = 0;
+  g_clock_msec = 0;
+  g_loop_cut_msec[0] = g_loop_cut_msec[1] = LOOP_NO_CUT;
 #ifdef __OPM_TIMER__
   g_int_counter = OPM_INTERVAL_COUNT;
 #else
   g_int_counter = TIMERD_INTERVAL_COUNT;
 #endif
-  g_pcm8pp_freq = pcm_channels == 1 && pcm_half_bit == 0 && pcm_half_rate == 0 ? 0x0d :
+  g_pcm8pp_freq = pcm_adpcm ? 0x04 :
+                  pcm_channels == 1 && pcm_half_bit == 0 && pcm_half_rate == 0 ? 0x0d :
                   pcm_channels == 1 && pcm_half_bit == 0 && pcm_half_rate == 1 ? 0x0a :
                   pcm_channels == 1 && pcm_half_bit == 1 && pcm_half_rate == 0 ? 0x15 :
                   pcm_channels == 1 && pcm_half_bit == 1 && pcm_half_rate == 1 ? 0x12 :
@@ -754,6 +1355,35 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
                   pcm_channels == 2 && pcm_half_bit == 0 && pcm_half_rate == 1 ? 0x1a :
                   pcm_channels == 2 && pcm_half_bit == 1 && pcm_half_rate == 0 ? 0x25 :
                   pcm_channels == 2 && pcm_half_bit == 1 && pcm_half_rate == 1 ? 0x22 : 0x1d;                      
+  g_sample_rate = pcm_adpcm ? MSM6258_SAMPLE_RATE : pcm_half_rate ? 22050 : 44100;
+  g_frame_bits = pcm_adpcm ? 4 : (pcm_half_bit ? 8 : 16) * pcm_channels;
+
+  // track cache of the indexed tracks, the first track is loaded before playback starts
+  if (track_slot_bytes > 0) {
+    if (trackcache_open(&g_track_cache, track_cache_mb * 1024 * 1024, track_slot_bytes) != 0) {
+      printf("error: track cache allocation error. (%d [KB] for %d tracks of up to %d [KB] required)\n",
+        (track_slot_bytes + 1023) / 1024 * TRACKCACHE_MIN_SLOTS, TRACKCACHE_MIN_SLOTS, (track_slot_bytes + 1023) / 1024);
+      goto exit;
+    }
+    printf("Track cache: %d slots of %d [KB] in high memory\n", g_track_cache.num_slots, g_track_cache.slot_bytes / 1024);
+    PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
+    if (pcm->cached) {
+      trackcache_prefetch(&g_track_cache, pcm->stream);
+      TRACK_SLOT* slot = g_track_cache.next;
+      while (slot->loaded_bytes < slot->bytes) {
+        if (B_SFTSNS() & 0x01) {
+          goto cancel;
+        }
+        if (trackcache_fill(&g_track_cache, &g_refill, 0, 0) == 0) {
+          printf("\nerror: file read error. (%s)\n", pcm->file_name);
+          goto exit;
+        }
+        show_progress(pcm->file_name, slot->loaded_bytes, slot->bytes);
+      }
+      printf("\rLoaded %s (%d.%dsec) into the track cache.\x1b[K\n", pcm->file_name, pcm->total_time_msec / 1000, pcm->total_time_msec / 100 % 10);
+    }
+    printf("Available high memory: %d [KB]\n", himem_getsize(1) / 1024);
+  }
 
 #ifdef __OPM_TIMER__
   // $14:OPM Timer Control
@@ -786,9 +1416,24 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
   }
 #endif
 
+  // hotkeys from the keyboard interrupt (the old vector is set first, a key may come at any time)
+  if (key_hook) {
+    keyhook_callback = key_hook_callback;
+    keyhook_old_vector = (void*)B_LPEEK((uint32_t*)(KEYHOOK_VECTOR * 4));
+    INTVCS(KEYHOOK_VECTOR, (void*)keyhook_entry);
+  }
+
+  // disk IOCS calls of other programs are seen by the refills of the stream ring and the track cache
+  if (g_stream.ring != NULL || g_track_cache.arena != NULL) {
+    for (int16_t i = 0; i < DISKHOOK_CALLS; i++) {
+      diskhook_old_vectors[i] = (void*)B_LPEEK((uint32_t*)DISKHOOK_TABLE(diskhook_calls[i]));
+      INTVCS(DISKHOOK_VECTOR(diskhook_calls[i]), diskhook_entries[i]);
+    }
+  }
+
   // start pcm8pp play
   PCM_MUSIC* current_pcm = &(g_pcm_music[ g_current_music ]);
-  pcm8pp_play(PCM8PP_CHANNEL, ( current_pcm->volume << 16 ) | ( g_pcm8pp_freq << 8 ) | 0x03, current_pcm->buffer_bytes, 44100*256, current_pcm->buffer);
+  play_music(current_pcm, current_pcm->volume);
   if (!quiet_mode) {
     B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
     if (current_pcm->kmd.tag_title[0] != '\0') {
@@ -798,15 +1443,27 @@ int32_t main(int32_t argc, uint8_t* argv[]) {
     }
   }
 
+  // the file opened by the loader for the track cache is not taken over, the resident part opens its own
+  refill_close(&g_refill);
+
+  // only the resident part linked before the loader is kept (its text up to _resident_end, see make-xdev68k.sh),
+  // the loader code, its data, bss, stack and heap are released
+  uint32_t resident_bytes = _resident_end - _PSP - 0xf0;
+  uint32_t kmd_bytes = 0;
+  for (int16_t i = 0; i < num_music; i++) {
+    if (g_pcm_music[i].shared) continue;
+    kmd_bytes += g_pcm_music[i].kmd.num_events * sizeof(KMD_EVENT);
+  }
+
   printf("--\n");
+  printf("Resident size: %d [bytes] + player state %d [bytes] + KMD events %d [bytes] in main memory\n",
+    resident_bytes, sizeof(RESIDENT_STATE), kmd_bytes);
   printf(PROGRAM_NAME " background playback service started. [CTRL]+[XF4] to pause. [CTRL]+[XF5] to skip.\n");
 
   rc = 0;
 
   // keep self process
-  extern uint32_t _HEND;
-//  extern unsigned int _PSP;
-  KEEPPR(_HEND - _PSP - 0xf0, rc);
+  KEEPPR(resident_bytes, rc);
 
 cancel:
   printf("\r\nCanceled.\n");
@@ -818,17 +1475,39 @@ exit:
     fclose(fp);
     fp = NULL;
   }
+  dosio_close(&pcm_io);
 
   // reclaim high memory buffers if opened
   for (int16_t i = 0; i < MAX_MUSIC; i++) {
     PCM_MUSIC* pcm = &(g_pcm_music[i]);
+    if (pcm->shared) continue;
     if (pcm->buffer != NULL) {
       himem_free(pcm->buffer, 1);
       pcm->buffer = NULL;
     }
+    if (pcm->stream != NULL) {
+      himem_free(pcm->stream, 0);
+      pcm->stream = NULL;
+    }
+    if (pcm->links != NULL) {
+      himem_free(pcm->links, 0);
+      pcm->links = NULL;
+    }
     kmd_close(&(pcm->kmd));
   }
 
+  // reclaim the zero block if allocated
+  if (g_zero_block != NULL) {
+    himem_free(g_zero_block, 1);
+    g_zero_block = NULL;
+  }
+
+  // reclaim stream ring if allocated
+  stream_close(&g_stream);
+
+  // reclaim track cache if allocated
+  trackcache_close(&g_track_cache);
+
   // reclaim file read buffer if opened
   if (fread_buffer != NULL) {
     himem_free(fread_buffer, 0);
@@ -838,5 +1517,17 @@ exit:
   // close ym2608 decoder handle
   ym2608_decode_close(&ym2608_decode);
 
+  // close sample rate converter handle
+  resample_close(&resampler);
+
+  // close z44 reader handle
+  z44_close(&z44_reader);
+
+  // close metadata cache
+  cache_close(&cache);
+
+  // reclaim the player state
+  resident_close();
+
   return rc;
 }
\ No newline at end of file
@@ -22,19 +22,40 @@ COMMON_FLAGS="-m68000 -Os -DXDEV68K ${INCLUDE_FLAGS}"
 CFLAGS="${COMMON_FLAGS} -Wno-builtin-declaration-mismatch -fcall-used-d2 -fcall-used-a2 \
     -fexec-charset=cp932 -fverbose-asm -fno-defer-pop -D_TIME_T_DECLARED -D_CLOCK_T_DECLARED -Dwint_t=int"
 
-LIBS="${XDEV68K_DIR}/lib/xc/CLIB.L ${XDEV68K_DIR}/lib/xc/DOSLIB.L ${XDEV68K_DIR}/lib/xc/IOCSLIB.L ${XDEV68K_DIR}/lib/xc/FLOATFNC.L \
+# no floating point in the sources, FLOATFNC.L is not linked (HLK names any symbol still needed from it)
+LIBS="${XDEV68K_DIR}/lib/xc/CLIB.L ${XDEV68K_DIR}/lib/xc/DOSLIB.L ${XDEV68K_DIR}/lib/xc/IOCSLIB.L \
       ${XDEV68K_DIR}/lib/m68k_elf/m68000/libgcc.a"
 
+# the resident part, linked first and kept by KEEPPR up to _resident_end (see resident.c)
+RESIDENT_FILES="resident pcm8pp refill stream trackcache loop silence trace profile"
+RESIDENT_ASM_FILES="keyhook diskhook"
+
+# the transient loader, released when the service has started
+LOADER_FILES="himem ym2608_decode kmd dosio wav z44 resample msm6258_encode profile_print cache trace_dump convert loudness main"
+LOADER_ASM_FILES="ym2608_adpcmlib"
+
+#
+#  compile C sources and assemble .s sources into _build ($1: directory, $2: C sources, $3: .s sources,
+#  $4: "resident" to move data and constants into the text)
+#
 function do_compile() {
   pushd .
   cd $1
-  rm -rf _build
   mkdir -p _build
   for c in $2; do
     echo "compiling ${c}.c in ${1}"
 	  ${CC} -S ${CFLAGS} -o _build/${c}.m68k-gas.s ${c}.c
     if [ ! -f _build/${c}.m68k-gas.s ]; then
       return 1
+    fi
+    if [ "$4" == "resident" ]; then
+      # the text of a resident module is kept as a whole, its variables and constants must be in it
+      sed -i -E -e 's/^\s*\.section\s+\.(data|rodata)[^ ]*.*$/\t.text/' -e 's/^\s*\.data\s*$/\t.text/' \
+        _build/${c}.m68k-gas.s
+      if grep -q -E '^\s*\.(bss|comm|lcomm)|^\s*\.section\s+\.bss' _build/${c}.m68k-gas.s; then
+        echo "error: ${c}.c has zero initialized variables outside of the resident part."
+        return 1
+      fi
     fi
 	  perl ${GAS2HAS} -i _build/${c}.m68k-gas.s -o _build/${c}.s
 	  rm -f _build/${c}.m68k-gas.s
@@ -54,20 +75,57 @@ function do_compile() {
   return 0
 }
 
-function build_s44bgp() {
-  do_compile . "pcm8pp himem ym2608_decode kmd main" "ym2608_adpcmlib"
-  if [ $? != 0 ]; then
-    return $?
+#
+#  compile a C source for a CPU variant ($1: source name, $2: variant)
+#
+function do_compile_variant() {
+  echo "compiling ${1}.c for ${2}"
+  ${CC} -S ${CFLAGS/-m68000/-m${2}} -DCONVERT_VARIANT=${2} -o _build/${1}_${2}.m68k-gas.s ${1}.c
+  if [ ! -f _build/${1}_${2}.m68k-gas.s ]; then
+    return 1
   fi
+  perl ${GAS2HAS/-cpu 68000/-cpu ${2}} -i _build/${1}_${2}.m68k-gas.s -o _build/${1}_${2}.s
+  rm -f _build/${1}_${2}.m68k-gas.s
+  ${XDEV68K_DIR}/run68/run68 ${HAS} -e -u -w0 ${INCLUDE_FLAGS} _build/${1}_${2}.s -o _build/${1}_${2}.o
+  if [ ! -f _build/${1}_${2}.o ]; then
+    return 1
+  fi
+  return 0
+}
+
+function build_s44bgp() {
+  rm -rf _build
+  do_compile . "${RESIDENT_FILES}" "${RESIDENT_ASM_FILES} resident_end" resident || return 1
+  do_compile . "${LOADER_FILES}" "${LOADER_ASM_FILES}" || return 1
+  for v in 68000 68020 68060; do
+    do_compile_variant convert_kernel ${v} || return 1
+  done
   cd _build
 	rm -f ${HLK_LINK_LIST}
   for a in ${LIBS}; do
     cp -p $a .
   done
-	for a in `ls *.o *.L *.a`; do
-		echo $a >> ${HLK_LINK_LIST}
+  # link order: the resident objects, the library modules they need (the libraries are scanned here first),
+  # the end mark, then the loader and the rest of the libraries
+  for a in ${RESIDENT_FILES} ${RESIDENT_ASM_FILES}; do
+    echo ${a}.o >> ${HLK_LINK_LIST}
+  done
+  for a in ${LIBS}; do
+    echo `basename $a` >> ${HLK_LINK_LIST}
+  done
+  echo resident_end.o >> ${HLK_LINK_LIST}
+  for a in ${LOADER_FILES} ${LOADER_ASM_FILES} convert_kernel_68000 convert_kernel_68020 convert_kernel_68060; do
+    echo ${a}.o >> ${HLK_LINK_LIST}
+  done
+  for a in ${LIBS}; do
+    echo `basename $a` >> ${HLK_LINK_LIST}
   done
   ${XDEV68K_DIR}/run68/run68 ${HLK} -i ${HLK_LINK_LIST} -o ${TARGET_FILE}
+  if [ ! -f ${TARGET_FILE} ]; then
+    echo "error: link error."
+    return 1
+  fi
+  echo "${TARGET_FILE}: `ls -l ${TARGET_FILE} | awk '{ print $5 }'` bytes"
   rm -f tmp*.\$$\$$\$$
   zip -jr ${ZIP_FILE} ${DOC_FILE} ${TARGET_FILE}
   cd ..
@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "sample.h"
+#include "msm6258_encode.h"
+
+static const int16_t step_table[] = {
+    16,   17,   19,   21,   23,   25,   28,   31,   34,   37,   41,   45,   50,   55,   60,   66,
+    73,   80,   88,   97,  107,  118,  130,  143,  157,  173,  190,  209,  230,  253,  279,  307,
+   337,  371,  408,  449,  494,  544,  598,  658,  724,  796,  876,  963, 1060, 1166, 1282, 1411,
+  1552,
+};
+
+static const int16_t index_shift[] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+//
+//  init ADPCM(MSM6258) encoder handle
+//
+void msm6258_encode_init(MSM6258_ENCODE_HANDLE* msm) {
+  msm->step_index = 0;
+  msm->predictor = 0;
+  msm->pending = 0;
+  msm->pending_code = 0;
+}
+
+//
+//  encode one 12bit sample into 4bit code
+//
+static inline uint8_t encode_sample(MSM6258_ENCODE_HANDLE* msm, int16_t x) {
+
+  int16_t step = step_table[ msm->step_index ];
+  int16_t diff = x - msm->predictor;
+  uint8_t code = 0;
+
+  if (diff < 0) {
+    code = 8;
+    diff = -diff;
+  }
+
+  // quantize and reconstruct exactly as the decoder does
+  int16_t delta = step >> 3;
+  if (diff >= step) {
+    code |= 4;
+    diff -= step;
+    delta += step;
+  }
+  if (diff >= (step >> 1)) {
+    code |= 2;
+    diff -= step >> 1;
+    delta += step >> 1;
+  }
+  if (diff >= (step >> 2)) {
+    code |= 1;
+    delta += step >> 2;
+  }
+
+  int16_t predictor = (code & 8) ? msm->predictor - delta : msm->predictor + delta;
+  msm->predictor = predictor > 2047 ? 2047 : predictor < -2048 ? -2048 : predictor;
+
+  int16_t step_index = msm->step_index + index_shift[ code & 7 ];
+  msm->step_index = step_index < 0 ? 0 : step_index > 48 ? 48 : step_index;
+
+  return code;
+}
+
+//
+//  encode 16bit PCM (mono or stereo, stereo is mixed down) into ADPCM(MSM6258), returns output bytes
+//  the first sample goes to the lower nibble, an odd sample is kept in the handle until the next call
+//
+size_t msm6258_encode_exec(MSM6258_ENCODE_HANDLE* msm, int16_t* pcm_data, size_t pcm_data_len, int16_t channels, uint8_t* adpcm_buffer) {
+
+  uint8_t* a = adpcm_buffer;
+
+  for (size_t i = 0; i < pcm_data_len; i += channels) {
+
+    int16_t x = channels == 1 ? SAMPLE(pcm_data[i]) >> 4 : ( SAMPLE(pcm_data[i]) + SAMPLE(pcm_data[i+1]) ) >> 5;
+    uint8_t code = encode_sample(msm, x);
+
+    if (msm->pending) {
+      *a++ = msm->pending_code | (code << 4);
+      msm->pending = 0;
+    } else {
+      msm->pending_code = code;
+      msm->pending = 1;
+    }
+  }
+
+  return a - adpcm_buffer;
+}
+
+//
+//  flush an odd sample, returns output bytes
+//
+size_t msm6258_encode_flush(MSM6258_ENCODE_HANDLE* msm, uint8_t* adpcm_buffer) {
+  if (!msm->pending) return 0;
+  adpcm_buffer[0] = msm->pending_code;
+  msm->pending = 0;
+  return 1;
+}
@@ -0,0 +1,23 @@
+#ifndef __H_MSM6258_ENCODE__
+#define __H_MSM6258_ENCODE__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MSM6258_SAMPLE_RATE (15625)
+
+typedef struct {
+
+  int16_t step_index;
+  int16_t predictor;
+
+  int16_t pending;
+  uint8_t pending_code;
+
+} MSM6258_ENCODE_HANDLE;
+
+void msm6258_encode_init(MSM6258_ENCODE_HANDLE* msm);
+size_t msm6258_encode_exec(MSM6258_ENCODE_HANDLE* msm, int16_t* pcm_data, size_t pcm_data_len, int16_t channels, uint8_t* adpcm_buffer);
+size_t msm6258_encode_flush(MSM6258_ENCODE_HANDLE* msm, uint8_t* adpcm_buffer);
+
+#endif
@@ -50,6 +50,7 @@ int32_t pcm8pp_play_array_chain(int16_t channel, uint32_t mode, uint32_t count,
 
   return reg_d0;
 }
+*/
 
 //
 //  play in linked array chain mode ($002x)
@@ -74,7 +75,7 @@ int32_t pcm8pp_play_linked_array_chain(int16_t channel, uint32_t mode, uint32_t
 
   return reg_d0;
 }
-
+/*
 //
 //  play in extended linked array chain mode ($003x)
 //
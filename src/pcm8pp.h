@@ -1,9 +1,16 @@
 #ifndef __H_PCM8PP__
 #define __H_PCM8PP__
 
+// linked array chain table entry (10 bytes on the target)
+typedef struct pcm8pp_link {
+  void* addr;
+  uint16_t length;
+  struct pcm8pp_link* next;
+} PCM8PP_LINK;
+
 int32_t pcm8pp_play(int16_t channel, uint32_t mode, uint32_t size, uint32_t freq, void* addr);
 //int32_t pcm8pp_play_array_chain(int16_t channel, uint32_t mode, uint32_t count, uint32_t freq, void* addr);
-//int32_t pcm8pp_play_linked_array_chain(int16_t channel, uint32_t mode, uint32_t size, uint32_t freq, void* addr);
+int32_t pcm8pp_play_linked_array_chain(int16_t channel, uint32_t mode, uint32_t size, uint32_t freq, void* addr);
 //int32_t pcm8pp_play_ex_linked_array_chain(int16_t channel, uint32_t mode, uint32_t size, uint32_t freq, void* addr);
 int32_t pcm8pp_set_channel_mode(int16_t channel, uint32_t mode);
 int32_t pcm8pp_get_data_length(int16_t channel);
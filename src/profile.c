@@ -0,0 +1,93 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <iocslib.h>
+#include "profile.h"
+
+// MFP timer-C data register, counts down from 200 to 0 in 50usec steps for the 10msec system tick
+#define MFP_TCDR ((uint8_t*)0xE88023)
+
+// MFP interrupt pending register B, timer-C bit (set until the tick is counted by the system)
+#define MFP_IPRB ((uint8_t*)0xE8800D)
+#define MFP_IPRB_TIMERC (0x20)
+
+// ONTIME wraps at midnight
+#define ONTIME_TICKS_PER_DAY (8640000)
+
+//
+//  elapsed part of the current 10msec tick in 50usec units
+//  (usable in interrupt handlers where the tick count does not advance, for intervals up to 10msec)
+//
+uint16_t profile_get_tick_count(void) {
+  uint8_t count = B_BPEEK(MFP_TCDR);
+  return 200 - (count > 200 ? 200 : count);
+}
+
+//
+//  read 10msec tick count and elapsed part of the current tick as one consistent pair
+//  (a tick that has expired while interrupts are masked is pending at the MFP and not counted yet)
+//
+void profile_get_clock(PROFILE_CLOCK* clock) {
+  uint32_t t0, t1;
+  uint16_t count;
+  uint8_t pending0, pending1;
+  do {
+    t0 = (uint32_t)ONTIME();
+    pending0 = B_BPEEK(MFP_IPRB) & MFP_IPRB_TIMERC;
+    count = profile_get_tick_count();
+    pending1 = B_BPEEK(MFP_IPRB) & MFP_IPRB_TIMERC;
+    t1 = (uint32_t)ONTIME();
+  } while (t0 != t1 || pending0 != pending1);
+  clock->ticks = pending1 ? t0 + 1 : t0;
+  clock->count = count;
+}
+
+//
+//  usec since a clock reading (wrap safe across 10msec ticks and midnight, for intervals up to 11 hours)
+//
+uint32_t profile_get_elapsed_usec(PROFILE_CLOCK* start) {
+  PROFILE_CLOCK now;
+  profile_get_clock(&now);
+  uint32_t ticks = (now.ticks + ONTIME_TICKS_PER_DAY - start->ticks) % ONTIME_TICKS_PER_DAY;
+  return ticks * 10000 + now.count * 50 - start->count * 50;
+}
+
+//
+//  free-running clock in usec (10msec tick count + elapsed part of the current tick, wraps in 71min)
+//
+uint32_t profile_get_usec(void) {
+  PROFILE_CLOCK clock;
+  profile_get_clock(&clock);
+  return clock.ticks * 10000 + clock.count * 50;
+}
+
+//
+//  reset counters
+//
+void profile_reset(PROFILE* prof) {
+  for (int16_t i = 0; i < PROFILE_STAGES; i++) {
+    prof->usec[i] = 0;
+    prof->bytes[i] = 0;
+  }
+}
+
+//
+//  accumulate counters
+//
+void profile_add(PROFILE* total, PROFILE* prof) {
+  for (int16_t i = 0; i < PROFILE_STAGES; i++) {
+    total->usec[i] += prof->usec[i];
+    total->bytes[i] += prof->bytes[i];
+  }
+}
+
+//
+//  checksum of loaded data (byte order independent)
+//
+uint32_t profile_get_checksum(const void* data, size_t bytes) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint32_t sum = 5381;
+  for (size_t i = 0; i < bytes; i++) {
+    sum = (sum << 5) + sum + p[i];
+  }
+  return sum;
+}
@@ -0,0 +1,36 @@
+#ifndef __H_PROFILE__
+#define __H_PROFILE__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PROFILE_OPEN    (0)
+#define PROFILE_PROBE   (1)
+#define PROFILE_READ    (2)
+#define PROFILE_DECODE  (3)
+#define PROFILE_CONVERT (4)
+#define PROFILE_KMD     (5)
+#define PROFILE_STAGES  (6)
+
+typedef struct {
+  uint32_t usec[ PROFILE_STAGES ];
+  uint32_t bytes[ PROFILE_STAGES ];
+} PROFILE;
+
+// clock reading for intervals that may cross the 10msec tick (IOCS ONTIME ticks + 50usec units)
+typedef struct {
+  uint32_t ticks;
+  uint16_t count;
+} PROFILE_CLOCK;
+
+uint16_t profile_get_tick_count(void);
+void profile_get_clock(PROFILE_CLOCK* clock);
+uint32_t profile_get_elapsed_usec(PROFILE_CLOCK* start);
+uint32_t profile_get_usec(void);
+void profile_reset(PROFILE* prof);
+void profile_add(PROFILE* total, PROFILE* prof);
+void profile_print(PROFILE* prof);
+void profile_print_tsv(const uint8_t* label, PROFILE* prof);
+uint32_t profile_get_checksum(const void* data, size_t bytes);
+
+#endif
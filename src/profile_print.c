@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "profile.h"
+
+static const uint8_t* STAGE_NAMES[] = { "open", "size probe", "read", "decode", "conversion", "kmd parse" };
+static const uint8_t* STAGE_KEYS[] = { "open", "probe", "read", "decode", "convert", "kmd" };
+
+//
+//  print counters as a table (stages without bytes have no throughput)
+//
+void profile_print(PROFILE* prof) {
+  uint32_t total_usec = 0;
+  for (int16_t i = 0; i < PROFILE_STAGES; i++) {
+    uint32_t usec = prof->usec[i];
+    total_usec += usec;
+    if (prof->bytes[i] > 0) {
+      uint32_t usec100 = usec / 100;
+      printf("  %-12s %6d.%d [ms] %6d [KB] %6d [KB/s]\n", STAGE_NAMES[i], usec / 1000, usec / 100 % 10,
+        prof->bytes[i] / 1024, prof->bytes[i] / 1024 * 10000 / (usec100 > 0 ? usec100 : 1));
+    } else {
+      printf("  %-12s %6d.%d [ms]\n", STAGE_NAMES[i], usec / 1000, usec / 100 % 10);
+    }
+  }
+  printf("  %-12s %6d.%d [ms]\n", "total", total_usec / 1000, total_usec / 100 % 10);
+}
+
+//
+//  print counters as tab separated lines to be compared across versions ("profile", label, stage, usec, bytes)
+//
+void profile_print_tsv(const uint8_t* label, PROFILE* prof) {
+  for (int16_t i = 0; i < PROFILE_STAGES; i++) {
+    printf("profile\t%s\t%s\t%d\t%d\n", label, STAGE_KEYS[i], prof->usec[i], prof->bytes[i]);
+  }
+}
@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <doslib.h>
+#include "diskhook.h"
+#include "refill.h"
+
+//
+//  initialize (file handles belong to a process, reads are made as the resident process)
+//
+void refill_open(REFILL* rf) {
+  memset(rf, 0, sizeof(REFILL));
+  rf->pdb = GETPDB();
+  rf->indos_flag = (volatile uint16_t*)INDOSFLG();
+}
+
+//
+//  close the files kept open (also from -r, with the state of the running instance)
+//
+void refill_close(REFILL* rf) {
+  if (rf->pdb == NULL) return;
+  void* saved_pdb = GETPDB();
+  SETPDB(rf->pdb);
+  for (int16_t i = 0; i < REFILL_FILES; i++) {
+    REFILL_FILE* f = &(rf->files[i]);
+    if (f->path != NULL) {
+      CLOSE(f->fd);
+      f->path = NULL;
+    }
+  }
+  SETPDB(saved_pdb);
+}
+
+//
+//  a read can be started from the interrupt handler (DOS is idle and no disk IOCS call was interrupted)
+//
+int16_t refill_is_idle(REFILL* rf) {
+  if (rf->busy) return 0;
+  if (*(rf->indos_flag) != 0 || diskhook_busy != 0) {
+    rf->deferred++;
+    return 0;
+  }
+  return 1;
+}
+
+//
+//  file of a path, opened when it is not open yet (the least recently used one is closed for it)
+//
+static REFILL_FILE* get_file(REFILL* rf, const uint8_t* path) {
+
+  REFILL_FILE* file = NULL;
+  for (int16_t i = 0; i < REFILL_FILES; i++) {
+    REFILL_FILE* f = &(rf->files[i]);
+    if (f->path == path) {
+      file = f;
+      goto exit;
+    }
+    if (file == NULL || f->path == NULL || (file->path != NULL && f->last_used < file->last_used)) file = f;
+  }
+
+  if (file->path != NULL) {
+    CLOSE(file->fd);
+    file->path = NULL;
+  }
+  int32_t fd = OPEN(path, 0);
+  if (fd < 0) {
+    file = NULL;
+    goto exit;
+  }
+  file->path = path;
+  file->fd = fd;
+  file->ofs = 0;
+  rf->opens++;
+
+exit:
+  if (file != NULL) file->last_used = ++rf->use_count;
+  return file;
+}
+
+//
+//  read a part of a file, returns bytes read or -1 (a file is opened once and read on from where
+//  the last read ended, seeks are made only when the position changes)
+//
+int32_t refill_read(REFILL* rf, const uint8_t* path, uint32_t ofs, void* buffer, uint32_t bytes) {
+
+  // default return code
+  int32_t rc = -1;
+
+  void* saved_pdb = GETPDB();
+  SETPDB(rf->pdb);
+
+  REFILL_FILE* file = get_file(rf, path);
+  if (file == NULL) goto exit;
+
+  if (file->ofs != ofs) {
+    rf->seeks++;
+    if (SEEK(file->fd, ofs, 0) != ofs) goto close;
+    file->ofs = ofs;
+  }
+
+  rf->reads++;
+  rc = READ(file->fd, buffer, bytes);
+  if (rc != bytes) goto close;
+  file->ofs += bytes;
+
+  goto exit;
+
+close:
+  // opened again by the next read
+  CLOSE(file->fd);
+  file->path = NULL;
+  rc = -1;
+
+exit:
+  SETPDB(saved_pdb);
+  return rc;
+}
@@ -0,0 +1,36 @@
+#ifndef __H_REFILL__
+#define __H_REFILL__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// files kept open by the resident process (a streamed track and a track being loaded into the track cache)
+#define REFILL_FILES (2)
+
+// an open file, found by the address of its path (the full path of a PCM_STREAM)
+typedef struct {
+  const uint8_t* path;        // NULL: not opened
+  int32_t fd;
+  uint32_t ofs;               // file position after the last read
+  uint32_t last_used;
+} REFILL_FILE;
+
+// disk reads of the resident part from the interrupt handler, shared by the stream ring and the track cache
+typedef struct {
+  void* pdb;
+  volatile uint16_t* indos_flag;
+  volatile int16_t busy;      // a read is running with interrupts enabled
+  uint32_t use_count;
+  uint32_t opens;
+  uint32_t seeks;
+  uint32_t reads;
+  uint32_t deferred;          // reads put off while DOS or a disk IOCS call was busy
+  REFILL_FILE files[ REFILL_FILES ];
+} REFILL;
+
+void refill_open(REFILL* rf);
+void refill_close(REFILL* rf);
+int16_t refill_is_idle(REFILL* rf);
+int32_t refill_read(REFILL* rf, const uint8_t* path, uint32_t ofs, void* buffer, uint32_t bytes);
+
+#endif
@@ -0,0 +1,187 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "himem.h"
+#include "sample.h"
+#include "resample.h"
+
+//
+//  quarter wave sine table (Q14, 64 steps for 0 to pi/2)
+//
+static const int16_t sine_table[] = {
+      0,   402,   804,  1205,  1606,  2006,  2404,  2801,  3196,  3590,  3981,  4370,  4756,
+   5139,  5520,  5897,  6270,  6639,  7005,  7366,  7723,  8076,  8423,  8765,  9102,  9434,
+   9760, 10080, 10394, 10702, 11003, 11297, 11585, 11866, 12140, 12406, 12665, 12916, 13160,
+  13395, 13623, 13842, 14053, 14256, 14449, 14635, 14811, 14978, 15137, 15286, 15426, 15557,
+  15679, 15791, 15893, 15986, 16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379, 16384,
+};
+
+//
+//  fixed point sine (angle: 0x10000 = 2pi, result: Q14)
+//
+static int32_t isin(uint32_t angle) {
+
+  uint32_t a = angle & 0x3fff;
+  uint32_t quadrant = (angle >> 14) & 0x03;
+  if (quadrant & 0x01) a = 0x4000 - a;
+
+  uint32_t idx = a >> 8;
+  uint32_t frac = a & 0xff;
+  int32_t v = sine_table[ idx ];
+  if (frac != 0) v += ((sine_table[ idx + 1 ] - v) * (int32_t)frac) >> 8;
+
+  return (quadrant & 0x02) ? -v : v;
+}
+
+//
+//  build polyphase windowed sinc coefficients (Q14, each phase normalized to unity gain)
+//
+static void make_coefs(int16_t* coefs, int32_t in_rate, int32_t out_rate) {
+
+  // cutoff frequency relative to the input nyquist frequency (Q16), 90% of the lower nyquist
+  uint32_t fc = out_rate < in_rate ? (uint32_t)out_rate * 58982 / (uint32_t)in_rate : 58982;
+
+  for (int16_t p = 0; p < RESAMPLE_PHASES; p++) {
+
+    int32_t h[ RESAMPLE_TAPS ];
+    int32_t sum = 0;
+
+    for (int16_t k = 0; k < RESAMPLE_TAPS; k++) {
+
+      // distance from the output point in input sample unit (Q16)
+      int32_t w = ((RESAMPLE_TAPS / 2 - 1 - k) << 16) + (p << (16 - RESAMPLE_PHASE_BITS));
+      uint32_t aw = w < 0 ? -w : w;
+
+      // sinc(fc * w) = sin(pi * u) / (pi * u)
+      uint32_t u = ((fc >> 2) * (aw >> 2)) >> 12;
+      int32_t sinc = 16384;
+      if (u != 0) {
+        int32_t denom = (int32_t)((u * 3217) >> 10);      // pi * u in Q16
+        sinc = (isin(u >> 1) << 16) / denom;
+      }
+
+      // blackman window
+      int32_t v = w / (RESAMPLE_TAPS / 2);
+      int32_t win = 6881 + ((8192 * isin((v >> 1) + 0x4000)) >> 14) + ((1311 * isin(v + 0x4000)) >> 14);
+
+      h[k] = (((int32_t)(fc >> 2) * sinc) >> 14) * win >> 14;
+      sum += h[k];
+    }
+
+    for (int16_t k = 0; k < RESAMPLE_TAPS; k++) {
+      coefs[ p * RESAMPLE_TAPS + k ] = (int16_t)((h[k] * 16384 + sum / 2) / sum);
+    }
+  }
+}
+
+//
+//  init resampler handle
+//
+int32_t resample_init(RESAMPLE_HANDLE* rs, int32_t in_rate, int32_t out_rate) {
+
+  int32_t rc = -1;
+
+  // baseline
+  rs->in_rate = in_rate;
+  rs->out_rate = out_rate;
+  rs->phase = 0;
+  rs->history_ofs = 0;
+  memset(rs->history_l, 0, sizeof(rs->history_l));
+  memset(rs->history_r, 0, sizeof(rs->history_r));
+  rs->coefs = NULL;
+
+  if (in_rate < RESAMPLE_MIN_RATE || in_rate > RESAMPLE_MAX_RATE) goto exit;
+  if (out_rate < RESAMPLE_MIN_RATE || out_rate > RESAMPLE_MAX_RATE) goto exit;
+
+  // phase step = in_rate / out_rate in fixed point, by long division to avoid 64bit arithmetic
+  uint32_t q = in_rate / out_rate;
+  uint32_t r = in_rate % out_rate;
+  for (int16_t i = 0; i < RESAMPLE_FRAC_BITS; i++) {
+    q <<= 1;
+    r <<= 1;
+    if (r >= out_rate) {
+      q |= 1;
+      r -= out_rate;
+    }
+  }
+  rs->phase_step = q;
+
+  // coefficient table allocation and initialization
+  rs->coefs = himem_malloc(sizeof(int16_t) * RESAMPLE_PHASES * RESAMPLE_TAPS, 0);
+  if (rs->coefs == NULL) goto exit;
+
+  make_coefs(rs->coefs, in_rate, out_rate);
+
+  rc = 0;
+
+exit:
+  return rc;
+}
+
+//
+//  close resampler handle
+//
+void resample_close(RESAMPLE_HANDLE* rs) {
+  if (rs->coefs != NULL) {
+    himem_free(rs->coefs, 0);
+    rs->coefs = NULL;
+  }
+}
+
+//
+//  convert 16bit stereo words (src_len in 16bit unit, returns output length in 16bit unit)
+//  dst must have room for src_len * out_rate / in_rate + 2 words at least
+//
+size_t resample_exec(RESAMPLE_HANDLE* rs, int16_t* src, size_t src_len, int16_t* dst) {
+
+  int16_t* d = dst;
+  size_t ofs = rs->history_ofs;
+  uint32_t phase = rs->phase;
+
+  for (size_t i = 0; i < src_len / 2; i++) {
+
+    // push a new frame into the mirrored history ring
+    rs->history_l[ ofs ] = rs->history_l[ ofs + RESAMPLE_TAPS ] = SAMPLE(src[ i * 2 + 0 ]);
+    rs->history_r[ ofs ] = rs->history_r[ ofs + RESAMPLE_TAPS ] = SAMPLE(src[ i * 2 + 1 ]);
+    ofs = (ofs + 1) & (RESAMPLE_TAPS - 1);
+
+    int16_t* hl = &(rs->history_l[ ofs ]);
+    int16_t* hr = &(rs->history_r[ ofs ]);
+
+    // emit all output frames that fall before the next input frame
+    while (phase < (1 << RESAMPLE_FRAC_BITS)) {
+
+      int16_t* c = rs->coefs + (phase >> (RESAMPLE_FRAC_BITS - RESAMPLE_PHASE_BITS)) * RESAMPLE_TAPS;
+
+      int32_t acc_l = 1 << (RESAMPLE_COEF_BITS - 1);
+      int32_t acc_r = 1 << (RESAMPLE_COEF_BITS - 1);
+      for (int16_t k = 0; k < RESAMPLE_TAPS; k++) {
+        acc_l += c[k] * hl[k];
+        acc_r += c[k] * hr[k];
+      }
+      acc_l >>= RESAMPLE_COEF_BITS;
+      acc_r >>= RESAMPLE_COEF_BITS;
+
+      d[0] = SAMPLE(acc_l > 32767 ? 32767 : acc_l < -32768 ? -32768 : acc_l);
+      d[1] = SAMPLE(acc_r > 32767 ? 32767 : acc_r < -32768 ? -32768 : acc_r);
+      d += 2;
+
+      phase += rs->phase_step;
+    }
+    phase -= 1 << RESAMPLE_FRAC_BITS;
+  }
+
+  rs->history_ofs = ofs;
+  rs->phase = phase;
+
+  return d - dst;
+}
+
+//
+//  converted data length in 16bit stereo unit (rounded up with some margin for the allocation)
+//
+size_t resample_get_length(size_t len, int32_t in_rate, int32_t out_rate) {
+  size_t frames = len / 2;
+  size_t out_frames = frames / in_rate * out_rate + ((frames % in_rate) * out_rate + in_rate - 1) / in_rate;
+  return (out_frames + 2) * 2;
+}
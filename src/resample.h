@@ -0,0 +1,39 @@
+#ifndef __H_RESAMPLE__
+#define __H_RESAMPLE__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RESAMPLE_TAPS       (16)
+#define RESAMPLE_PHASE_BITS (5)
+#define RESAMPLE_PHASES     (1 << RESAMPLE_PHASE_BITS)
+#define RESAMPLE_FRAC_BITS  (24)
+#define RESAMPLE_COEF_BITS  (14)
+
+// any rate between the PCM8PP rates (host/check.c covers the wav rates into all of them),
+// while the loader only asks for 44.1kHz, 22.05kHz (-2) and 15.625kHz (-a)
+#define RESAMPLE_MIN_RATE   (15625)
+#define RESAMPLE_MAX_RATE   (48000)
+
+typedef struct {
+
+  int32_t in_rate;
+  int32_t out_rate;
+
+  uint32_t phase;
+  uint32_t phase_step;
+
+  size_t history_ofs;
+  int16_t history_l[ RESAMPLE_TAPS * 2 ];
+  int16_t history_r[ RESAMPLE_TAPS * 2 ];
+
+  int16_t* coefs;
+
+} RESAMPLE_HANDLE;
+
+int32_t resample_init(RESAMPLE_HANDLE* rs, int32_t in_rate, int32_t out_rate);
+void resample_close(RESAMPLE_HANDLE* rs);
+size_t resample_exec(RESAMPLE_HANDLE* rs, int16_t* src, size_t src_len, int16_t* dst);
+size_t resample_get_length(size_t len, int32_t in_rate, int32_t out_rate);
+
+#endif
@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <iocslib.h>
+#include "himem.h"
+#include "pcm8pp.h"
+#include "kmd.h"
+#include "profile.h"
+#include "refill.h"
+#include "stream.h"
+#include "trackcache.h"
+#include "loop.h"
+#include "silence.h"
+#include "trace.h"
+#include "s44bgp.h"
+#include "resident.h"
+
+//
+//  resident part of the player (linked before the loader, kept by KEEPPR up to _resident_end)
+//
+//  Only code that runs after the loader has exited is here: the interrupt handlers, the PCM8PP glue
+//  and the playlist/KMD tables. The state is in one main memory block allocated by the loader.
+//
+
+RESIDENT_HEADER g_resident = { RESIDENT_EYE_CATCH, NULL };
+
+//
+//  allocate the state block (main memory, owned by the process and kept with it)
+//
+int32_t resident_open(void) {
+  g_resident.state = himem_malloc(sizeof(RESIDENT_STATE), 0);
+  if (g_resident.state == NULL) return -1;
+  memset(g_resident.state, 0, sizeof(RESIDENT_STATE));
+  refill_open(&g_refill);
+  return 0;
+}
+
+//
+//  reclaim the state block (the loader exits without staying resident)
+//
+void resident_close(void) {
+  if (g_resident.state != NULL) {
+    refill_close(&g_refill);
+    himem_free(g_resident.state, 0);
+    g_resident.state = NULL;
+  }
+}
+
+//
+//  shuffle order (the seed of rand() is in the C library data, which is not kept resident)
+//
+int16_t resident_rand(void) {
+  g_rand_seed = g_rand_seed * 1103515245 + 12345;
+  return (int16_t)((g_rand_seed >> 16) & 0x7fff);
+}
+
+//
+//  position to the last KMD event started by the given time (it is shown again)
+//
+static void seek_kmd(KMD_HANDLE* kmd, uint32_t msec) {
+  size_t ofs = 0;
+  while (ofs < kmd->num_events && kmd->events[ ofs ].start_msec <= msec) ofs++;
+  kmd->current_event_ofs = ofs > 0 ? ofs - 1 : 0;
+}
+
+#define OPM_REG_PORT  ((uint8_t*)0xE90001)
+#define OPM_DATA_PORT ((uint8_t*)0xE90003)
+
+//
+//  loop player, loop cut time and resume link of a channel
+//
+static int16_t get_loop_index(int16_t channel) {
+  return channel == PCM8PP_CHANNEL ? 0 : 1;
+}
+
+//
+//  start playback of a track from the top on the current channel
+//
+void play_music(PCM_MUSIC* pcm, int16_t volume) {
+  uint32_t mode = ( volume << 16 ) | ( g_pcm8pp_freq << 8 ) | 0x03;
+  int16_t loop_index = get_loop_index(g_channel);
+  pcm->kmd.current_event_ofs = 0;
+  g_interrupted = 0;
+  g_resumes = 0;
+  g_fade_channel = -1;
+  g_pending_mode = 0;
+  g_loop_cut_msec[ loop_index ] = LOOP_NO_CUT;
+  trace_add(&g_trace, g_clock_msec, TRACE_START, g_current_music, g_channel);
+  if (pcm->loop_end > 0) {
+    // intro and loop body in one chain, the body goes round until the chain is cut
+    stream_stop(&g_stream);
+    if (loop_play(&(g_loop[ loop_index ]), g_channel, mode, 44100*256, pcm->buffer, pcm->loop_start, pcm->loop_end) == 0) {
+      g_loop_cut_msec[ loop_index ] = pcm->loop_cut_msec;
+    }
+  } else if (pcm->cached) {
+    // the next track is known ahead and loaded while this one plays, a track still loading starts when it can
+    stream_stop(&g_stream);
+    TRACK_SLOT* slot = trackcache_play(&g_track_cache, pcm->stream);
+    PCM_MUSIC* next_pcm = &(g_pcm_music[ g_next_music ]);
+    trackcache_prefetch(&g_track_cache, next_pcm->cached ? next_pcm->stream : NULL);
+    if (trackcache_is_playable(slot)) {
+      pcm8pp_play(g_channel, mode, slot->bytes, 44100*256, slot->buffer);
+    } else {
+      g_pending_mode = mode;
+    }
+  } else if (pcm->stream != NULL) {
+    stream_play(&g_stream, g_channel, pcm->stream, pcm->buffer, pcm->buffer_bytes, mode, 44100*256);
+  } else if (pcm->links != NULL) {
+    stream_stop(&g_stream);
+    pcm8pp_play_linked_array_chain(g_channel, mode, 0, 44100*256, pcm->links);
+  } else {
+    stream_stop(&g_stream);
+    pcm8pp_play(g_channel, mode, pcm->buffer_bytes, 44100*256, pcm->buffer);
+  }
+}
+
+//
+//  go to the next track, the one after it is chosen at the same time so that it can be loaded in advance
+//
+static PCM_MUSIC* advance_music(void) {
+  g_current_music = g_next_music;
+  g_next_music = g_shuffle_mode ? resident_rand() % g_num_music : (g_current_music + 1) % g_num_music;
+  return &(g_pcm_music[ g_current_music ]);
+}
+
+//
+//  track is in high memory as a whole
+//
+static int16_t is_ready(PCM_MUSIC* pcm) {
+  return pcm->cached ? trackcache_is_ready(&g_track_cache, pcm->stream) : 1;
+}
+
+//
+//  volume step of a fading track (linear in the fade time)
+//
+static int16_t get_fade_volume(int16_t volume, uint32_t msec) {
+  return msec >= g_fade_msec ? volume : (int16_t)(volume * msec / g_fade_msec);
+}
+
+//
+//  restart playback of a track stopped by another program at the position of the interrupt clock
+//  (whole frames of the current mode, 2 samples per byte in ADPCM mode) and catch up the KMD events
+//
+static int32_t resume_music(PCM_MUSIC* pcm) {
+  uint32_t mode = ( pcm->volume << 16 ) | ( g_pcm8pp_freq << 8 ) | 0x03;
+  uint32_t frames = g_elapsed_time / 1000 * g_sample_rate + g_elapsed_time % 1000 * g_sample_rate / 1000;
+  uint32_t ofs = frames * (g_frame_bits / 4) / 2;
+  seek_kmd(&(pcm->kmd), g_elapsed_time);
+  if (pcm->loop_end > 0) {
+    return loop_resume(&(g_loop[ get_loop_index(g_channel) ]), g_channel, mode, 44100*256, ofs);
+  } else if (pcm->cached) {
+    TRACK_SLOT* slot = trackcache_find(&g_track_cache, pcm->stream);
+    if (slot == NULL || ofs >= slot->bytes) return -1;
+    return pcm8pp_play(g_channel, mode, slot->bytes - ofs, 44100*256, slot->buffer + ofs);
+  } else if (pcm->stream != NULL) {
+    return stream_resume(&g_stream, g_channel, ofs, mode, 44100*256);
+  } else if (pcm->links != NULL) {
+    return silence_resume(pcm->links, &(g_silence_resume_link[ get_loop_index(g_channel) ]), g_channel, mode, 44100*256, ofs);
+  }
+  if (ofs >= pcm->buffer_bytes) return -1;
+  return pcm8pp_play(g_channel, mode, pcm->buffer_bytes - ofs, 44100*256, (uint8_t*)pcm->buffer + ofs);
+}
+
+//
+//  pause/skip keys held down now
+//
+static int16_t get_key_command(void) {
+//  uint8_t key1 = *((uint8_t*)0x80e);      // CTRL key
+//  uint8_t key2 = *((uint8_t*)0x80b);      // XF4/XF5 key
+  if (B_SFTSNS() & 0x02) {                  // CTRL key
+    int32_t sense_code = BITSNS(0x0b);
+    if (sense_code & 0x01) return KEY_COMMAND_PAUSE;    // XF4
+    if (sense_code & 0x02) return KEY_COMMAND_SKIP;     // XF5
+  }
+  return 0;
+}
+
+//
+//  keyboard interrupt hook (called by keyhook.s after the IOCS handler updated the key matrix),
+//  a command is posted to the timer interrupt only when its keys go down
+//
+void key_hook_callback(void) {
+  int16_t command = get_key_command();
+  g_isr_stat.key_events++;
+  if (command != 0 && command != g_key_last_command) {
+    g_key_command = command;
+  }
+  g_key_last_command = command;
+}
+
+//
+//  countdown of the handler calls, the stop checks, key polls and KMD events run at fixed counts
+//
+static void count_down(void) {
+  g_int_counter--;
+  if (g_int_counter < 0) {
+#ifdef __OPM_TIMER__
+    g_int_counter = OPM_INTERVAL_COUNT;
+#else
+    g_int_counter = TIMERD_INTERVAL_COUNT;
+#endif
+  }
+}
+
+//
+//  timer-D / OPM timer-B interrupt handler
+//
+void __INTERRUPT__ __timer_interrupt_handler__(void) {
+
+  PROFILE_CLOCK isr_start;
+  profile_get_clock(&isr_start);
+
+  // total play time and the clock of the track cache
+#ifdef __OPM_TIMER__
+  g_clock_msec += OPM_INTERVAL_MSEC;
+#else
+  g_clock_msec += TIMERD_INTERVAL_MSEC;
+#endif
+  if (!g_paused) {
+#ifdef __OPM_TIMER__
+    g_elapsed_time += OPM_INTERVAL_MSEC;
+#else
+    g_elapsed_time += TIMERD_INTERVAL_MSEC;
+#endif
+  }
+
+#ifdef __OPM_TIMER__
+  while (OPMSNS() & 0x80);
+  OPMSET(0x14, 0x2a);
+#endif
+
+  // interrupted a disk refill of our own, only the clock and the countdown are kept
+  // (counted apart from the calls, so that the average duration is of the complete runs)
+  if (g_refill.busy) {
+    g_isr_stat.overruns++;
+    trace_add(&g_trace, g_clock_msec, TRACE_OVERRUN, g_current_music, 0);
+    count_down();
+    return;
+  }
+  g_isr_stat.calls++;
+
+  // crossfade, the next track is started on the other channel before the current one ends and PCM8PP mixes both
+  // (a streamed track needs the refill ring to its end, so it is not faded out)
+  if (g_fade_msec > 0 && !g_paused) {
+    PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
+    if (g_fade_channel >= 0) {
+      int16_t in_volume = get_fade_volume(pcm->volume, g_elapsed_time);
+      int16_t out_volume = g_fade_volume - get_fade_volume(g_fade_volume, g_elapsed_time);
+      pcm8pp_set_channel_mode(g_channel, ( in_volume << 16 ) | 0xffff);
+      pcm8pp_set_channel_mode(g_fade_channel, ( out_volume << 16 ) | 0xffff);
+      if (g_elapsed_time >= g_fade_msec) {
+        g_fade_channel = -1;
+      }
+    } else if ((pcm->stream == NULL || pcm->cached) && pcm->total_time_msec > g_fade_msec * 2 &&
+               g_elapsed_time + g_fade_msec >= pcm->total_time_msec && g_pending_mode == 0 &&
+               is_ready(&(g_pcm_music[ g_next_music ]))) {
+      int16_t fade_channel = g_channel;
+      int16_t fade_volume = pcm->volume;
+      int16_t fade_loop_index = get_loop_index(fade_channel);
+      g_isr_stat.crossfades++;
+      trace_add(&g_trace, g_clock_msec, TRACE_CROSSFADE, g_current_music, fade_channel);
+      // the loop cut time of the track fading out goes on from the new start
+      if (g_loop_cut_msec[ fade_loop_index ] != LOOP_NO_CUT) {
+        g_loop_cut_msec[ fade_loop_index ] = g_loop_cut_msec[ fade_loop_index ] > g_elapsed_time ?
+          g_loop_cut_msec[ fade_loop_index ] - g_elapsed_time : 0;
+      }
+      pcm = advance_music();
+      g_channel = g_channel == PCM8PP_CHANNEL ? PCM8PP_FADE_CHANNEL : PCM8PP_CHANNEL;
+      play_music(pcm, 0);
+      g_fade_channel = fade_channel;
+      g_fade_volume = fade_volume;
+      if (!g_quiet_mode) {
+        B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
+        if (pcm->kmd.tag_title[0] != '\0') {
+          B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->kmd.tag_title);
+        } else {
+          B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->file_name);
+        }
+      }
+      g_elapsed_time = 0;
+    }
+  }
+
+  // a repeated loop body plays to its end in the last repetition
+  if (!g_paused) {
+    for (int16_t i = 0; i < 2; i++) {
+      if (g_loop_cut_msec[i] != LOOP_NO_CUT && g_elapsed_time >= g_loop_cut_msec[i]) {
+        loop_cut(&(g_loop[i]));
+        g_loop_cut_msec[i] = LOOP_NO_CUT;
+      }
+    }
+  }
+
+  // check playback stop
+  if (g_int_counter == 8) {
+    g_isr_stat.stop_checks++;
+    if (!g_paused && g_pending_mode == 0 && pcm8pp_get_data_length(g_channel) == 0) {
+      // really ended?
+      if (g_elapsed_time < g_pcm_music[ g_current_music ].total_time_msec - 1500) {
+        // probablly pcm8pp playback was stopped externally, resumed when the channel is still free at the next check
+        // (the clock keeps running, so the music goes on where it would have been)
+        PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
+        if (!g_interrupted) {
+          g_interrupted = 1;
+          g_isr_stat.interrupted++;
+          trace_add(&g_trace, g_clock_msec, TRACE_STOPPED, g_current_music, g_elapsed_time);
+        } else if (g_resumes < MAX_RESUMES && resume_music(pcm) == 0) {
+          g_interrupted = 0;
+          g_resumes++;
+          g_isr_stat.resumed++;
+          trace_add(&g_trace, g_clock_msec, TRACE_RESTART, g_current_music, g_resumes);
+          if (!g_quiet_mode) {
+            B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
+            if (pcm->kmd.tag_title[0] != '\0') {
+              B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->kmd.tag_title);
+            } else {
+              B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->file_name);
+            }
+          }
+        } else {
+          // stopped again and again, give the channel up until CTRL+XF4
+          g_interrupted = 0;
+          pcm8pp_pause();
+          stream_stop(&g_stream);
+          g_paused = 1;
+          g_isr_stat.aborted++;
+          trace_add(&g_trace, g_clock_msec, TRACE_ABORT, g_current_music, 0);
+          if (!g_quiet_mode) {
+            B_PUTMES(6, 0, 31, 66, SJIS_ONPU "ABORTED.");
+          }
+        }
+      } else {
+        // next music
+        g_isr_stat.next_music++;
+        trace_add(&g_trace, g_clock_msec, TRACE_END, g_current_music, 0);
+        PCM_MUSIC* pcm = advance_music();
+        play_music(pcm, pcm->volume);
+        if (!g_quiet_mode) {
+          B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
+          if (pcm->kmd.tag_title[0] != '\0') {
+            B_PUTMES(6, 2, 31, 64, pcm->kmd.tag_title);
+          } else {
+            B_PUTMES(6, 2, 31, 64, pcm->file_name);
+          }
+        }
+        g_paused = 0;
+        g_elapsed_time = 0;
+      }
+    }
+  }
+
+  // check pause/resume (posted by the keyboard hook, or polled)
+  int16_t key_command = 0;
+  if (g_key_hook) {
+    key_command = g_key_command;
+    g_key_command = 0;
+#ifdef __OPM_TIMER__
+  } else if (g_int_counter & 0x01) {
+#else
+  } else if (g_int_counter == 4) {
+#endif
+    g_isr_stat.key_checks++;
+    key_command = get_key_command();
+  }
+  if (key_command == KEY_COMMAND_PAUSE) {       // CTRL + XF4 (pause/resume)
+    if (g_paused) {
+      pcm8pp_resume();
+      g_resumes = 0;
+      g_isr_stat.resume++;
+      trace_add(&g_trace, g_clock_msec, TRACE_RESUME, g_current_music, 0);
+      if (!g_quiet_mode) {
+        PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
+        B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
+        if (pcm->kmd.tag_title[0] != '\0') {
+          B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->kmd.tag_title);
+        } else {
+          B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->file_name);
+        }
+      }
+      g_paused = 0;
+    } else {
+      pcm8pp_pause();
+      g_isr_stat.pause++;
+      trace_add(&g_trace, g_clock_msec, TRACE_PAUSE, g_current_music, 0);
+      if (!g_quiet_mode) {
+        B_PUTMES(6, 0, 31, MAX_DISP_LEN, SJIS_ONPU "PAUSED.");
+      }
+      g_paused = 1;
+    }
+  } else if (key_command == KEY_COMMAND_SKIP) {  // CTRL + XF5 (skip)
+    pcm8pp_stop();
+    g_isr_stat.skip++;
+    trace_add(&g_trace, g_clock_msec, TRACE_SKIP, g_current_music, 0);
+    PCM_MUSIC* pcm = advance_music();
+    play_music(pcm, pcm->volume);
+    if (!g_quiet_mode) {
+      B_PUTMES(6, 0, 31, 2, SJIS_ONPU);
+      if (pcm->kmd.tag_title[0] != '\0') {
+        B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->kmd.tag_title);
+      } else {
+        B_PUTMES(6, 2, 31, MAX_DISP_LEN - 2, pcm->file_name);
+      }
+    }
+    g_paused = 0;
+    g_elapsed_time = 0;
+  }
+
+  // check KMD event
+#ifdef __OPM_TIMER__
+  if (1) {
+#else
+  if (g_int_counter == 2) {
+#endif
+    if (!g_quiet_mode) {
+      PCM_MUSIC* pcm = &(g_pcm_music[ g_current_music ]);
+      KMD_HANDLE* kmd = &(pcm->kmd);
+      if (kmd->current_event_ofs < kmd->num_events) {
+        KMD_EVENT* event = &(kmd->events[ kmd->current_event_ofs ]);
+        if (event->start_msec <= 500) {      // do not show first 0.5 sec KMD events to ensure file name display
+          kmd->current_event_ofs++;
+        } else if (event->start_msec <= g_elapsed_time) {
+          B_PUTMES(6, event->pos_x * 2, 31, MAX_DISP_LEN - event->pos_x * 2, event->message);
+          trace_add(&g_trace, g_clock_msec, TRACE_KMD, g_current_music, kmd->current_event_ofs);
+          kmd->current_event_ofs++;
+          g_isr_stat.kmd_events++;
+        }
+      }
+    }
+  }
+
+  // refill the stream ring while DOS and the disk IOCS are idle, the disk I/O needs lower priority interrupts
+  if (!g_paused && stream_is_due(&g_stream, g_elapsed_time) && refill_is_idle(&g_refill)) {
+    g_refill.busy = 1;
+    __ENABLE_INTERRUPTS__();
+    stream_refill(&g_stream, &g_refill, g_elapsed_time);
+    g_refill.busy = 0;
+  }
+
+  // load the current track (started before it was complete) or the next one into the track cache
+  if (!g_paused && trackcache_is_due(&g_track_cache) && refill_is_idle(&g_refill)) {
+    g_refill.busy = 1;
+    __ENABLE_INTERRUPTS__();
+    trackcache_fill(&g_track_cache, &g_refill, g_clock_msec, g_pending_mode != 0 ? 0 : g_elapsed_time / 10 * (STREAM_BYTES_PER_SEC / 100));
+    g_refill.busy = 0;
+  }
+
+  // a track missing in the cache starts as soon as enough of it is loaded
+  if (g_pending_mode != 0 && !g_paused && trackcache_is_playable(g_track_cache.current)) {
+    pcm8pp_play(g_channel, g_pending_mode, g_track_cache.current->bytes, 44100*256, g_track_cache.current->buffer);
+    g_pending_mode = 0;
+    g_elapsed_time = 0;
+  }
+
+  count_down();
+
+  // handler duration (refills run with interrupts enabled and may take more than one 10msec tick)
+  uint32_t isr_usec = profile_get_elapsed_usec(&isr_start);
+  g_isr_stat.total_usec += isr_usec;
+  if (isr_usec > g_isr_stat.max_usec) {
+    g_isr_stat.max_usec = isr_usec;
+  }
+  if (isr_usec >= TRACE_SLOW_USEC) {
+    trace_add(&g_trace, g_clock_msec, TRACE_SLOW, g_current_music, isr_usec);
+  }
+
+}
@@ -0,0 +1,125 @@
+#ifndef __H_RESIDENT__
+#define __H_RESIDENT__
+
+#include <stdint.h>
+#include "pcm8pp.h"
+#include "refill.h"
+#include "stream.h"
+#include "trackcache.h"
+#include "loop.h"
+#include "trace.h"
+#include "s44bgp.h"
+
+#define __OPM_TIMER__
+
+// the host simulation build calls the handler as a plain function from its virtual timer
+#ifdef __HOST_SIM__
+#define __INTERRUPT__
+#define __ENABLE_INTERRUPTS__()
+#else
+#define __INTERRUPT__ __attribute__((interrupt))
+#define __ENABLE_INTERRUPTS__() asm volatile ("andi.w #0xf8ff,%%sr" ::: "memory")
+#endif
+
+#define RESIDENT_EYE_CATCH "Bgp#44pG"
+
+//
+//  everything the interrupt handler touches, in one main memory block kept with the process
+//  (zero filled tables in the resident text would be stored in the executable)
+//
+typedef struct {
+
+  PCM_MUSIC pcm_music[ MAX_MUSIC ];
+  int16_t num_music;
+  int16_t quiet_mode;
+  int16_t shuffle_mode;
+  ISR_STAT isr_stat;
+  TRACE_RING trace;
+  REFILL refill;
+  STREAM_PLAYER stream;
+  TRACK_CACHE track_cache;
+  LOOP_PLAYER loop[2];
+  PCM8PP_LINK silence_resume_link[2];
+  uint8_t* zero_block;
+  uint32_t rand_seed;
+  int16_t key_last_command;
+
+  volatile uint32_t pcm8pp_freq;
+  volatile uint32_t sample_rate;
+  volatile int16_t frame_bits;
+  volatile int16_t interrupted;
+  volatile int16_t resumes;
+  volatile int16_t channel;
+  volatile int16_t fade_channel;
+  volatile int16_t fade_volume;
+  volatile uint32_t fade_msec;
+  volatile int16_t current_music;
+  volatile int16_t next_music;
+  volatile uint32_t pending_mode;
+  volatile uint32_t clock_msec;
+  volatile uint32_t loop_cut_msec[2];
+  volatile int16_t paused;
+  volatile int16_t key_hook;
+  volatile int16_t key_command;
+  volatile int32_t int_counter;
+  volatile uint32_t elapsed_time;
+
+} RESIDENT_STATE;
+
+//
+//  the only variable of the resident part, moved into its text by the build (found by -r/-stat/-trace at the same offset
+//  from the PDB of the running instance)
+//
+typedef struct {
+  uint8_t eye_catch[ EYE_CATCH_LEN ];
+  RESIDENT_STATE* state;
+} RESIDENT_HEADER;
+
+extern RESIDENT_HEADER g_resident;
+
+// the player state is used by its old global names
+#define g_pcm_music           (g_resident.state->pcm_music)
+#define g_num_music           (g_resident.state->num_music)
+#define g_quiet_mode          (g_resident.state->quiet_mode)
+#define g_shuffle_mode        (g_resident.state->shuffle_mode)
+#define g_isr_stat            (g_resident.state->isr_stat)
+#define g_trace               (g_resident.state->trace)
+#define g_refill              (g_resident.state->refill)
+#define g_stream              (g_resident.state->stream)
+#define g_track_cache         (g_resident.state->track_cache)
+#define g_loop                (g_resident.state->loop)
+#define g_silence_resume_link (g_resident.state->silence_resume_link)
+#define g_zero_block          (g_resident.state->zero_block)
+#define g_rand_seed           (g_resident.state->rand_seed)
+#define g_key_last_command    (g_resident.state->key_last_command)
+#define g_pcm8pp_freq         (g_resident.state->pcm8pp_freq)
+#define g_sample_rate         (g_resident.state->sample_rate)
+#define g_frame_bits          (g_resident.state->frame_bits)
+#define g_interrupted         (g_resident.state->interrupted)
+#define g_resumes             (g_resident.state->resumes)
+#define g_channel             (g_resident.state->channel)
+#define g_fade_channel        (g_resident.state->fade_channel)
+#define g_fade_volume         (g_resident.state->fade_volume)
+#define g_fade_msec           (g_resident.state->fade_msec)
+#define g_current_music       (g_resident.state->current_music)
+#define g_next_music          (g_resident.state->next_music)
+#define g_pending_mode        (g_resident.state->pending_mode)
+#define g_clock_msec          (g_resident.state->clock_msec)
+#define g_loop_cut_msec       (g_resident.state->loop_cut_msec)
+#define g_paused              (g_resident.state->paused)
+#define g_key_hook            (g_resident.state->key_hook)
+#define g_key_command         (g_resident.state->key_command)
+#define g_int_counter         (g_resident.state->int_counter)
+#define g_elapsed_time        (g_resident.state->elapsed_time)
+
+// end of the resident part (resident_end.s, a longword holding its own address like _BEND)
+extern uint32_t _resident_end;
+
+int32_t resident_open(void);
+void resident_close(void);
+int16_t resident_rand(void);
+void play_music(PCM_MUSIC* pcm, int16_t volume);
+void key_hook_callback(void);
+void __INTERRUPT__ __timer_interrupt_handler__(void);
+
+#endif
@@ -0,0 +1,15 @@
+*
+*	end of the resident part (linked after the resident objects and the library modules they need)
+*
+*	The longword holds its own address, so that C code reads the end address as the value of _resident_end.
+*
+
+		.xdef	_resident_end
+
+		.text
+		.even
+
+_resident_end:
+		.dc.l	_resident_end
+
+		end
@@ -1,6 +1,8 @@
 #ifndef __H_S44BGP__
+#define __H_S44BGP__
 
 #include "kmd.h"
+#include "stream.h"
 
 #define PROGRAM_NAME     "S44BGP.X"
 #define PROGRAM_VERSION  "0.4.0 (2023/03/23)"
@@ -8,6 +10,8 @@
 #define EYE_CATCH "Bgp#44pM"
 #define EYE_CATCH_LEN (8)
 
+#define STAT_EYE_CATCH "Bgp#44pS"
+
 #define MAX_MUSIC (32)
 #define MAX_PATH_LEN (256)
 #define MAX_DISP_LEN (66)
@@ -15,7 +19,15 @@
 #define FREAD_BUFFER_LEN (44100 * 4)
 #define YM2608_DECODE_BUFFER_BYTES (44100 * 4 * 2)
 
+// read length in 16bit unit rounded down to 1024 bytes so that every read keeps sector alignment
+#define FREAD_ALIGNED_LEN (FREAD_BUFFER_LEN & ~511)
+#define YM2608_READ_LEN   ((YM2608_DECODE_BUFFER_BYTES / 4 / sizeof(int16_t)) & ~511)
+
 #define PCM8PP_CHANNEL (1)
+#define PCM8PP_FADE_CHANNEL (2)
+
+// tracks are crossfaded on the two channels in turn
+#define MAX_CROSSFADE_SEC (30)
 
 #define TIMERD_INTERVAL_MSEC  (10)
 #define TIMERD_INTERVAL_COUNT (16)
@@ -23,6 +35,13 @@
 #define OPM_INTERVAL_MSEC  (64)
 #define OPM_INTERVAL_COUNT (10)
 
+// playback stopped by other programs is resumed this many times per track
+#define MAX_RESUMES (8)
+
+// commands of the hotkeys (CTRL+XF4, CTRL+XF5)
+#define KEY_COMMAND_PAUSE (1)
+#define KEY_COMMAND_SKIP  (2)
+
 #define SJIS_ONPU "\x81\xf4"
 
 typedef struct {
@@ -30,9 +49,39 @@ typedef struct {
   int16_t* buffer;
   uint32_t buffer_bytes;
   int16_t volume;
+  uint16_t rms;             // loudness of the 16bit data measured at load time
+  uint16_t peak;
+  uint8_t shared;           // buffer and KMD events belong to an earlier entry of the same file
   uint32_t total_time_msec;
   uint8_t file_name[ 256 ];
   KMD_HANDLE kmd;
+  PCM_STREAM* stream;       // non NULL: only the head is in the buffer, the tail is streamed from disk
+  uint8_t cached;           // no buffer, the stream source is loaded into the track cache when it is played
+  uint32_t loop_start;      // non zero loop_end: the buffer is the intro and one loop body (byte offsets),
+  uint32_t loop_end;        // the body is repeated by a circular chain
+  uint32_t loop_cut_msec;   // the chain is cut in the last repetition (LOOP_NO_CUT: endless)
+  PCM8PP_LINK* links;       // non NULL: the buffer is played as a chain with long silences from the shared zero block
 } PCM_MUSIC;
 
+// interrupt handler statistics kept in the resident block (durations in usec)
+typedef struct {
+  uint8_t eye_catch[ EYE_CATCH_LEN ];
+  uint32_t calls;
+  uint32_t total_usec;
+  uint32_t max_usec;
+  uint32_t stop_checks;
+  uint32_t next_music;
+  uint32_t aborted;
+  uint32_t key_checks;
+  uint32_t pause;
+  uint32_t resume;
+  uint32_t skip;
+  uint32_t kmd_events;
+  uint32_t interrupted;
+  uint32_t resumed;
+  uint32_t crossfades;
+  uint32_t key_events;
+  uint32_t overruns;        // calls that interrupted a disk refill of the handler, not in calls and the durations
+} ISR_STAT;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef __H_SAMPLE__
+#define __H_SAMPLE__
+
+#include <stdint.h>
+
+// PCM data are big endian 16bit samples in memory as PCM8PP plays them (native on the target,
+// swapped by every stage that reads or writes them on the little endian host of the simulation build)
+// (SAMPLE32 is a longword of two samples, or of four 8bit samples, as the 68000 reads and writes it)
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SAMPLE(x)   ((int16_t)(x))
+#define SAMPLE32(x) ((uint32_t)(x))
+#else
+#define SAMPLE(x)   ((int16_t)__builtin_bswap16(x))
+#define SAMPLE32(x) ((uint32_t)__builtin_bswap32(x))
+#endif
+
+#endif
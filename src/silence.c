@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "himem.h"
+#include "sample.h"
+#include "silence.h"
+
+//
+//  all samples of a frame are silent
+//
+static int16_t is_silent(const uint8_t* frame, int16_t frame_bytes, int16_t bits) {
+  if (bits == 16) {
+    const int16_t* s = (const int16_t*)frame;
+    for (int16_t i = 0; i < frame_bytes / 2; i++) {
+      if ((uint16_t)(SAMPLE(s[i]) + SILENCE_LEVEL) > SILENCE_LEVEL * 2) return 0;
+    }
+  } else {
+    for (int16_t i = 0; i < frame_bytes; i++) {
+      if (frame[i] != 0x00 && frame[i] != 0xff) return 0;
+    }
+  }
+  return 1;
+}
+
+//
+//  find head and tail silences and internal ones at least min_gap_bytes long (up to SILENCE_MAX_GAPS)
+//
+void silence_scan(SILENCE_MAP* map, const uint8_t* buffer, uint32_t bytes, int16_t frame_bytes, int16_t bits, uint32_t min_gap_bytes) {
+
+  memset(map, 0, sizeof(SILENCE_MAP));
+  bytes -= bytes % frame_bytes;
+  map->bytes = bytes;
+
+  uint32_t start = 0;
+  while (start < bytes && is_silent(buffer + start, frame_bytes, bits)) start += frame_bytes;
+
+  // an all silent track is left as it is
+  if (start >= bytes) return;
+
+  uint32_t end = bytes;
+  while (is_silent(buffer + end - frame_bytes, frame_bytes, bits)) end -= frame_bytes;
+
+  map->head_bytes = start;
+  map->tail_bytes = bytes - end;
+
+  // runs of silence between them
+  uint32_t run_ofs = start;
+  for (uint32_t ofs = start; ofs < end && map->num_gaps < SILENCE_MAX_GAPS; ofs += frame_bytes) {
+    if (!is_silent(buffer + ofs, frame_bytes, bits)) {
+      if (ofs - run_ofs >= min_gap_bytes) {
+        map->gap_ofs[ map->num_gaps ] = run_ofs;
+        map->gap_len[ map->num_gaps ] = ofs - run_ofs;
+        map->gap_bytes += ofs - run_ofs;
+        map->num_gaps++;
+      }
+      run_ofs = ofs + frame_bytes;
+    }
+  }
+}
+
+//
+//  move the sounding parts to the top of the buffer in place, returns the bytes left
+//
+uint32_t silence_compact(SILENCE_MAP* map, uint8_t* buffer) {
+
+  uint32_t end = map->bytes - map->tail_bytes;
+  uint32_t src = map->head_bytes;
+  uint8_t* dst = buffer;
+
+  for (int16_t i = 0; i <= map->num_gaps; i++) {
+    uint32_t seg_end = i < map->num_gaps ? map->gap_ofs[i] : end;
+    memmove(dst, buffer + src, seg_end - src);
+    dst += seg_end - src;
+    if (i < map->num_gaps) src = map->gap_ofs[i] + map->gap_len[i];
+  }
+
+  return dst - buffer;
+}
+
+//
+//  links of a region, returns the next free link
+//
+static PCM8PP_LINK* add_links(PCM8PP_LINK* link, uint8_t* addr, uint32_t len, int16_t repeat) {
+  for (uint32_t ofs = 0; ofs < len; ofs += SILENCE_LINK_BYTES) {
+    link->addr = repeat ? addr : addr + ofs;
+    link->length = len - ofs > SILENCE_LINK_BYTES ? SILENCE_LINK_BYTES : len - ofs;
+    link->next = link + 1;
+    link++;
+  }
+  return link;
+}
+
+//
+//  chain of a compacted buffer with the internal silences played from the zero block (main memory block)
+//
+PCM8PP_LINK* silence_make_links(SILENCE_MAP* map, uint8_t* buffer, uint32_t bytes, void* zero_block) {
+
+  // sounding parts are in the compacted buffer in order, so the gap offsets go down by the gaps before them
+  uint32_t num_links = (bytes + SILENCE_LINK_BYTES - 1) / SILENCE_LINK_BYTES + map->num_gaps;
+  for (int16_t i = 0; i < map->num_gaps; i++) {
+    num_links += (map->gap_len[i] + SILENCE_LINK_BYTES - 1) / SILENCE_LINK_BYTES;
+  }
+
+  PCM8PP_LINK* links = himem_malloc(sizeof(PCM8PP_LINK) * num_links, 0);
+  if (links == NULL) return NULL;
+
+  PCM8PP_LINK* link = links;
+  uint32_t ofs = 0;
+  uint32_t skipped = map->head_bytes;
+  for (int16_t i = 0; i <= map->num_gaps; i++) {
+    uint32_t seg_end = i < map->num_gaps ? map->gap_ofs[i] - skipped : bytes;
+    link = add_links(link, buffer + ofs, seg_end - ofs, 0);
+    if (i < map->num_gaps) {
+      link = add_links(link, zero_block, map->gap_len[i], 1);
+      skipped += map->gap_len[i];
+    }
+    ofs = seg_end;
+  }
+  link[-1].next = NULL;
+
+  return links;
+}
+
+//
+//  restart playback at a byte offset of the chain (gaps included), entered through a copy of the link
+//  that holds the offset
+//
+int32_t silence_resume(PCM8PP_LINK* links, PCM8PP_LINK* resume_link, int16_t channel, uint32_t mode, uint32_t freq, uint32_t ofs) {
+  for (PCM8PP_LINK* link = links; link != NULL; link = link->next) {
+    if (ofs < link->length) {
+      resume_link->addr = (uint8_t*)link->addr + ofs;
+      resume_link->length = link->length - ofs;
+      resume_link->next = link->next;
+      return pcm8pp_play_linked_array_chain(channel, mode, 0, freq, resume_link);
+    }
+    ofs -= link->length;
+  }
+  return -1;
+}
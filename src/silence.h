@@ -0,0 +1,34 @@
+#ifndef __H_SILENCE__
+#define __H_SILENCE__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pcm8pp.h"
+
+// 16bit samples within this level are silence (about -60dBFS), 8bit samples below their resolution (0 and -1)
+#define SILENCE_LEVEL (32)
+
+// internal silence at least this long is played from the shared zero block, shorter one is kept as it is
+#define SILENCE_MIN_GAP_MSEC (1000)
+#define SILENCE_MAX_GAPS     (64)
+
+// a link holds less than 64KB in whole frames of every PCM mode, the zero block is one link long
+#define SILENCE_LINK_BYTES (0xff00)
+
+// head, tail and internal silences found in a loaded track (byte offsets in the PCM mode)
+typedef struct {
+  uint32_t bytes;             // whole frames scanned
+  uint32_t head_bytes;
+  uint32_t tail_bytes;
+  uint32_t gap_bytes;
+  int16_t num_gaps;
+  uint32_t gap_ofs[ SILENCE_MAX_GAPS ];
+  uint32_t gap_len[ SILENCE_MAX_GAPS ];
+} SILENCE_MAP;
+
+void silence_scan(SILENCE_MAP* map, const uint8_t* buffer, uint32_t bytes, int16_t frame_bytes, int16_t bits, uint32_t min_gap_bytes);
+uint32_t silence_compact(SILENCE_MAP* map, uint8_t* buffer);
+PCM8PP_LINK* silence_make_links(SILENCE_MAP* map, uint8_t* buffer, uint32_t bytes, void* zero_block);
+int32_t silence_resume(PCM8PP_LINK* links, PCM8PP_LINK* resume_link, int16_t channel, uint32_t mode, uint32_t freq, uint32_t ofs);
+
+#endif
@@ -0,0 +1,192 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <doslib.h>
+#include "himem.h"
+#include "stream.h"
+
+//
+//  open stream player (allocate the refill ring in high memory)
+//
+int32_t stream_open(STREAM_PLAYER* sp) {
+
+  // default return code
+  int32_t rc = -1;
+
+  if (sp == NULL) goto exit;
+  if (sp->ring != NULL) {
+    rc = 0;
+    goto exit;
+  }
+
+  memcpy(sp->eye_catch, STREAM_EYE_CATCH, STREAM_EYE_CATCH_LEN);
+  sp->ring = himem_malloc(STREAM_BLOCK_BYTES * STREAM_BLOCKS, 1);
+  if (sp->ring == NULL) goto exit;
+
+  sp->current = NULL;
+  sp->refills = 0;
+  sp->underruns = 0;
+
+  rc = 0;
+
+exit:
+  return rc;
+}
+
+//
+//  close stream player
+//
+void stream_close(STREAM_PLAYER* sp) {
+  sp->current = NULL;
+  if (sp->ring != NULL) {
+    himem_free(sp->ring, 1);
+    sp->ring = NULL;
+  }
+}
+
+//
+//  initialize stream source (the path is made absolute, refills run in the context of other processes)
+//
+int32_t stream_init(PCM_STREAM* stream, const uint8_t* file_name, uint32_t tail_ofs, uint32_t tail_bytes) {
+
+  // default return code
+  int32_t rc = -1;
+
+  struct NAMECKBUF nameck;
+  if (NAMECK(file_name, &nameck) < 0) goto exit;
+  if (2 + strlen(nameck.path) + strlen(nameck.name) + strlen(nameck.ext) >= STREAM_PATH_LEN) goto exit;
+
+  memcpy(stream->full_path, nameck.drive, 2);
+  strcpy(stream->full_path + 2, nameck.path);
+  strcat(stream->full_path, nameck.name);
+  strcat(stream->full_path, nameck.ext);
+  stream->tail_ofs = tail_ofs;
+  stream->tail_bytes = tail_bytes & ~0x03;
+
+  rc = 0;
+
+exit:
+  return rc;
+}
+
+//
+//  start playback of the resident head chained to the refill ring (linked array chain mode)
+//
+int32_t stream_play(STREAM_PLAYER* sp, int16_t channel, PCM_STREAM* stream, void* head, uint32_t head_bytes, uint32_t mode, uint32_t freq) {
+
+  sp->current = NULL;
+
+  // head in as large chunks as PCM8PP takes
+  int16_t n = 0;
+  for (uint32_t ofs = 0; ofs < head_bytes && n < STREAM_MAX_LINKS - STREAM_BLOCKS; ofs += STREAM_LINK_BYTES) {
+    sp->links[n].addr = (uint8_t*)head + ofs;
+    sp->links[n].length = head_bytes - ofs > STREAM_LINK_BYTES ? STREAM_LINK_BYTES : head_bytes - ofs;
+    sp->links[n].next = &(sp->links[ n + 1 ]);
+    n++;
+  }
+  sp->head_links = n;
+  sp->head_bytes = head_bytes;
+
+  // refill ring is circular, the last block cuts the chain when it is read
+  for (int16_t i = 0; i < STREAM_BLOCKS; i++) {
+    sp->links[ n + i ].addr = sp->ring + STREAM_BLOCK_BYTES * i;
+    sp->links[ n + i ].length = STREAM_BLOCK_BYTES;
+    sp->links[ n + i ].next = &(sp->links[ n + (i + 1) % STREAM_BLOCKS ]);
+  }
+
+  sp->num_blocks = (stream->tail_bytes + STREAM_BLOCK_BYTES - 1) / STREAM_BLOCK_BYTES;
+  sp->next_block = 0;
+  sp->current = stream;
+
+  return pcm8pp_play_linked_array_chain(channel, mode, 0, freq, sp->links);
+}
+
+//
+//  restart playback of the current track at a byte offset, the chain is entered through a copy of the link
+//  that holds the offset (the ring keeps being refilled by the clock while playback is stopped)
+//
+int32_t stream_resume(STREAM_PLAYER* sp, int16_t channel, uint32_t ofs, uint32_t mode, uint32_t freq) {
+
+  if (sp->current == NULL) return -1;
+
+  PCM8PP_LINK* link = NULL;
+  uint32_t link_ofs = 0;
+  if (ofs < sp->head_bytes) {
+    link = &(sp->links[ ofs / STREAM_LINK_BYTES ]);
+    link_ofs = ofs % STREAM_LINK_BYTES;
+  } else {
+    uint32_t block = (ofs - sp->head_bytes) / STREAM_BLOCK_BYTES;
+    if (block >= sp->num_blocks || block + STREAM_BLOCKS < sp->next_block) return -1;
+    // a block not read yet is read next, stale ring data are played until then as in an underrun
+    if (block > sp->next_block) sp->next_block = block;
+    link = &(sp->links[ sp->head_links + block % STREAM_BLOCKS ]);
+    link_ofs = ofs - sp->head_bytes - block * STREAM_BLOCK_BYTES;
+  }
+  if (link_ofs >= link->length) return -1;
+
+  sp->resume_link.addr = (uint8_t*)link->addr + link_ofs;
+  sp->resume_link.length = link->length - link_ofs;
+  sp->resume_link.next = link->next;
+
+  return pcm8pp_play_linked_array_chain(channel, mode, 0, freq, &(sp->resume_link));
+}
+
+//
+//  stop refills (the next track is fully resident or playback is stopped)
+//
+void stream_stop(STREAM_PLAYER* sp) {
+  sp->current = NULL;
+}
+
+//
+//  estimated playback position in bytes (the interrupt clock follows the played time)
+//
+static uint32_t get_played_bytes(uint32_t elapsed_msec) {
+  return elapsed_msec / 10 * (STREAM_BYTES_PER_SEC / 100) + elapsed_msec % 10 * (STREAM_BYTES_PER_SEC / 1000);
+}
+
+//
+//  a ring block can be refilled (the block it replaces and one more margin block were played)
+//
+int16_t stream_is_due(STREAM_PLAYER* sp, uint32_t elapsed_msec) {
+  if (sp->current == NULL || sp->next_block >= sp->num_blocks) return 0;
+  if (sp->next_block < STREAM_BLOCKS) return 1;
+  uint32_t replaced_end = sp->head_bytes + (sp->next_block - STREAM_BLOCKS + 2) * STREAM_BLOCK_BYTES;
+  return get_played_bytes(elapsed_msec) >= replaced_end ? 1 : 0;
+}
+
+//
+//  read due blocks of the tail into the ring, returns number of blocks read
+//  (called from the interrupt handler only while the disk is idle, the file stays open between refills)
+//
+int16_t stream_refill(STREAM_PLAYER* sp, REFILL* rf, uint32_t elapsed_msec) {
+
+  int16_t num_read = 0;
+  PCM_STREAM* stream = sp->current;
+
+  while (num_read < STREAM_REFILL_BLOCKS && stream_is_due(sp, elapsed_msec)) {
+
+    uint32_t block = sp->next_block;
+    PCM8PP_LINK* link = &(sp->links[ sp->head_links + block % STREAM_BLOCKS ]);
+    uint32_t block_bytes = stream->tail_bytes - block * STREAM_BLOCK_BYTES;
+    if (block_bytes > STREAM_BLOCK_BYTES) block_bytes = STREAM_BLOCK_BYTES;
+
+    // playback already went into this block
+    if (get_played_bytes(elapsed_msec) > sp->head_bytes + block * STREAM_BLOCK_BYTES) {
+      sp->underruns++;
+    }
+
+    if (refill_read(rf, stream->full_path, stream->tail_ofs + block * STREAM_BLOCK_BYTES, link->addr, block_bytes) != block_bytes) break;
+
+    if (block == sp->num_blocks - 1) {
+      link->length = block_bytes;
+      link->next = NULL;
+    }
+
+    sp->next_block++;
+    sp->refills++;
+    num_read++;
+  }
+
+  return num_read;
+}
@@ -0,0 +1,60 @@
+#ifndef __H_STREAM__
+#define __H_STREAM__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pcm8pp.h"
+#include "refill.h"
+
+#define STREAM_EYE_CATCH     "Bgp#44pR"
+#define STREAM_EYE_CATCH_LEN (8)
+
+// only 44.1kHz 16bit stereo raw data are streamed, so the tail is played as it is on the disk
+#define STREAM_BYTES_PER_SEC (44100 * 4)
+
+// refill ring (about 3sec), a few blocks are read per interrupt
+#define STREAM_BLOCK_BYTES   (0x8000)
+#define STREAM_BLOCKS        (16)
+#define STREAM_REFILL_BLOCKS (2)
+
+// resident head
+#define STREAM_LINK_BYTES    (0xff00)
+#define STREAM_MAX_LINKS     (256)
+#define STREAM_MAX_HEAD_SEC  ((STREAM_MAX_LINKS - STREAM_BLOCKS) * STREAM_LINK_BYTES / STREAM_BYTES_PER_SEC)
+#define STREAM_MIN_HEAD_SEC  (3)
+#define STREAM_DEFAULT_SEC   (10)
+
+#define STREAM_PATH_LEN (96)
+
+// per track stream source (main memory block owned by the resident process)
+typedef struct {
+  uint8_t full_path[ STREAM_PATH_LEN ];
+  uint32_t tail_ofs;
+  uint32_t tail_bytes;
+} PCM_STREAM;
+
+// refill state of the track being played
+typedef struct {
+  uint8_t eye_catch[ STREAM_EYE_CATCH_LEN ];
+  uint8_t* ring;
+  PCM_STREAM* current;
+  uint32_t head_bytes;
+  int16_t head_links;
+  uint32_t num_blocks;
+  uint32_t next_block;
+  uint32_t refills;
+  uint32_t underruns;
+  PCM8PP_LINK links[ STREAM_MAX_LINKS ];
+  PCM8PP_LINK resume_link;
+} STREAM_PLAYER;
+
+int32_t stream_open(STREAM_PLAYER* sp);
+void stream_close(STREAM_PLAYER* sp);
+int32_t stream_init(PCM_STREAM* stream, const uint8_t* file_name, uint32_t tail_ofs, uint32_t tail_bytes);
+int32_t stream_play(STREAM_PLAYER* sp, int16_t channel, PCM_STREAM* stream, void* head, uint32_t head_bytes, uint32_t mode, uint32_t freq);
+int32_t stream_resume(STREAM_PLAYER* sp, int16_t channel, uint32_t ofs, uint32_t mode, uint32_t freq);
+void stream_stop(STREAM_PLAYER* sp);
+int16_t stream_is_due(STREAM_PLAYER* sp, uint32_t elapsed_msec);
+int16_t stream_refill(STREAM_PLAYER* sp, REFILL* rf, uint32_t elapsed_msec);
+
+#endif
@@ -0,0 +1,24 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "trace.h"
+
+//
+//  clear the ring
+//
+void trace_init(TRACE_RING* tr) {
+  memset(tr, 0, sizeof(TRACE_RING));
+  memcpy(tr->eye_catch, TRACE_EYE_CATCH, TRACE_EYE_CATCH_LEN);
+}
+
+//
+//  record an event (from the interrupt handler, the entry is taken before it is filled so that
+//  a nested handler writes into the next one)
+//
+void trace_add(TRACE_RING* tr, uint32_t clock_msec, int16_t type, int16_t track, int32_t arg) {
+  TRACE_ENTRY* e = &(tr->entries[ tr->count++ & (TRACE_ENTRIES - 1) ]);
+  e->clock_msec = clock_msec;
+  e->type = type;
+  e->track = track;
+  e->arg = arg;
+}
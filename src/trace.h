@@ -0,0 +1,49 @@
+#ifndef __H_TRACE__
+#define __H_TRACE__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRACE_EYE_CATCH     "Bgp#44pT"
+#define TRACE_EYE_CATCH_LEN (8)
+
+// the last events are kept (a power of 2)
+#define TRACE_ENTRIES (128)
+
+// a handler running longer than this is traced (the tick count wraps every 10msec)
+#define TRACE_SLOW_USEC (5000)
+
+// event types
+#define TRACE_START     (1)     // track started (arg: channel)
+#define TRACE_END       (2)     // track played to its end
+#define TRACE_SKIP      (3)     // CTRL+XF5
+#define TRACE_PAUSE     (4)     // CTRL+XF4
+#define TRACE_RESUME    (5)     // CTRL+XF4 while paused
+#define TRACE_STOPPED   (6)     // channel found stopped by another program (arg: elapsed msec)
+#define TRACE_RESTART   (7)     // playback restarted after an external stop (arg: restarts of the track)
+#define TRACE_ABORT     (8)     // stopped too many times, given up
+#define TRACE_KMD       (9)     // KMD event shown (arg: event index)
+#define TRACE_CROSSFADE (10)    // crossfade into the next track started (arg: channel fading out)
+#define TRACE_OVERRUN   (11)    // the next interrupt came while the handler was reading the disk
+#define TRACE_SLOW      (12)    // handler took longer than TRACE_SLOW_USEC (arg: usec)
+#define TRACE_TYPES     (13)
+
+typedef struct {
+  uint32_t clock_msec;        // interrupt clock since the service started
+  int16_t type;
+  int16_t track;
+  int32_t arg;
+} TRACE_ENTRY;
+
+// ring of timestamped events in the resident block, read by -trace
+typedef struct {
+  uint8_t eye_catch[ TRACE_EYE_CATCH_LEN ];
+  uint32_t count;             // events recorded so far
+  TRACE_ENTRY entries[ TRACE_ENTRIES ];
+} TRACE_RING;
+
+void trace_init(TRACE_RING* tr);
+void trace_add(TRACE_RING* tr, uint32_t clock_msec, int16_t type, int16_t track, int32_t arg);
+void trace_dump(TRACE_RING* tr, uint32_t clock_msec, uint32_t wall_time);
+
+#endif
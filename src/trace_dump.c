@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "trace.h"
+
+static const uint8_t* g_type_names[ TRACE_TYPES ] = {
+  "-", "start", "end", "skip", "pause", "resume", "stopped", "restart", "abort", "kmd", "crossfade", "overrun", "slow",
+};
+
+//
+//  print the events of a ring copied from the running instance, oldest first
+//  (the wall clock time of each event is estimated from the current one of DOS _GETTIM2, in seconds)
+//
+void trace_dump(TRACE_RING* tr, uint32_t clock_msec, uint32_t wall_time) {
+
+  uint32_t first = tr->count > TRACE_ENTRIES ? tr->count - TRACE_ENTRIES : 0;
+  printf("trace: %d events recorded, last %d shown\n", tr->count, tr->count - first);
+  printf("     clock  wall clock  track  event\n");
+
+  // hour << 16 | minute << 8 | second
+  uint32_t now = (wall_time >> 16 & 0xff) * 3600 + (wall_time >> 8 & 0xff) * 60 + (wall_time & 0xff);
+
+  for (uint32_t i = first; i < tr->count; i++) {
+    TRACE_ENTRY* e = &(tr->entries[ i & (TRACE_ENTRIES - 1) ]);
+    uint32_t ago = clock_msec > e->clock_msec ? (clock_msec - e->clock_msec + 500) / 1000 : 0;
+    uint32_t t = (now + 24 * 60 * 60 - ago % (24 * 60 * 60)) % (24 * 60 * 60);
+    printf("%6d.%03d    %02d:%02d:%02d  %5d  %s", e->clock_msec / 1000, e->clock_msec % 1000,
+      t / 3600, t / 60 % 60, t % 60, e->track + 1,
+      e->type > 0 && e->type < TRACE_TYPES ? g_type_names[ e->type ] : g_type_names[0]);
+    switch (e->type) {
+      case TRACE_START:
+      case TRACE_CROSSFADE:
+        printf(" (channel %d)", e->arg);
+        break;
+      case TRACE_STOPPED:
+        printf(" (at %d.%03d sec)", e->arg / 1000, e->arg % 1000);
+        break;
+      case TRACE_RESTART:
+        printf(" (%d of the track)", e->arg);
+        break;
+      case TRACE_KMD:
+        printf(" (event %d)", e->arg + 1);
+        break;
+      case TRACE_SLOW:
+        printf(" (%d [us])", e->arg);
+        break;
+    }
+    printf("\n");
+  }
+}
@@ -0,0 +1,183 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "himem.h"
+#include "trackcache.h"
+
+//
+//  open track cache (allocate as many slots of the largest track as the budget takes in high memory)
+//
+int32_t trackcache_open(TRACK_CACHE* tc, uint32_t budget_bytes, uint32_t slot_bytes) {
+
+  // default return code
+  int32_t rc = -1;
+
+  if (tc == NULL || slot_bytes == 0) goto exit;
+
+  memset(tc, 0, sizeof(TRACK_CACHE));
+  memcpy(tc->eye_catch, TRACKCACHE_EYE_CATCH, TRACKCACHE_EYE_CATCH_LEN);
+
+  tc->slot_bytes = (slot_bytes + 3) & ~0x03;
+  tc->num_slots = budget_bytes / tc->slot_bytes > TRACKCACHE_MAX_SLOTS ? TRACKCACHE_MAX_SLOTS : budget_bytes / tc->slot_bytes;
+  if (tc->num_slots < TRACKCACHE_MIN_SLOTS) goto exit;
+
+  tc->arena = himem_malloc(tc->slot_bytes * tc->num_slots, 1);
+  if (tc->arena == NULL) goto exit;
+
+  for (int16_t i = 0; i < tc->num_slots; i++) {
+    tc->slots[i].buffer = tc->arena + tc->slot_bytes * i;
+  }
+
+  rc = 0;
+
+exit:
+  return rc;
+}
+
+//
+//  close track cache
+//
+void trackcache_close(TRACK_CACHE* tc) {
+  tc->current = tc->previous = tc->next = NULL;
+  if (tc->arena != NULL) {
+    himem_free(tc->arena, 1);
+    tc->arena = NULL;
+  }
+}
+
+//
+//  slot holding a track (fully or partly loaded), NULL if it is not in the cache
+//
+TRACK_SLOT* trackcache_find(TRACK_CACHE* tc, PCM_STREAM* source) {
+  for (int16_t i = 0; i < tc->num_slots; i++) {
+    if (tc->slots[i].source == source) return &(tc->slots[i]);
+  }
+  return NULL;
+}
+
+//
+//  give a track an empty or the least recently used slot, except the two given ones
+//
+static TRACK_SLOT* assign_slot(TRACK_CACHE* tc, PCM_STREAM* source, TRACK_SLOT* keep0, TRACK_SLOT* keep1) {
+  TRACK_SLOT* slot = NULL;
+  for (int16_t i = 0; i < tc->num_slots; i++) {
+    TRACK_SLOT* s = &(tc->slots[i]);
+    if (s == keep0 || s == keep1) continue;
+    if (s->source == NULL) {
+      slot = s;
+      break;
+    }
+    if (slot == NULL || s->last_used < slot->last_used) slot = s;
+  }
+  slot->source = source;
+  slot->bytes = source->tail_bytes < tc->slot_bytes ? source->tail_bytes : tc->slot_bytes;
+  slot->loaded_bytes = 0;
+  slot->last_used = ++tc->use_count;
+  return slot;
+}
+
+//
+//  a track is played, counted as a hit when it is fully loaded (a missing track evicts one)
+//
+TRACK_SLOT* trackcache_play(TRACK_CACHE* tc, PCM_STREAM* source) {
+  TRACK_SLOT* slot = trackcache_find(tc, source);
+  if (slot != NULL && slot->loaded_bytes >= slot->bytes) {
+    tc->hits++;
+  } else {
+    tc->misses++;
+  }
+  if (slot == NULL) {
+    slot = assign_slot(tc, source, tc->current, tc->next);
+  }
+  if (slot != tc->current) {
+    tc->previous = tc->current;
+    tc->current = slot;
+  }
+  slot->last_used = ++tc->use_count;
+  return slot;
+}
+
+//
+//  the track played next is loaded after the current one (NULL: the next track is not cached)
+//  the current track and the one fading out are never evicted for it
+//
+void trackcache_prefetch(TRACK_CACHE* tc, PCM_STREAM* source) {
+  if (source == NULL) {
+    tc->next = NULL;
+    return;
+  }
+  TRACK_SLOT* slot = trackcache_find(tc, source);
+  if (slot == NULL) {
+    slot = assign_slot(tc, source, tc->current, tc->previous);
+  }
+  tc->next = slot;
+}
+
+//
+//  a track is fully loaded
+//
+int16_t trackcache_is_ready(TRACK_CACHE* tc, PCM_STREAM* source) {
+  TRACK_SLOT* slot = trackcache_find(tc, source);
+  return slot != NULL && slot->loaded_bytes >= slot->bytes ? 1 : 0;
+}
+
+//
+//  enough of a track is loaded to start playback while the rest is loaded
+//
+int16_t trackcache_is_playable(TRACK_SLOT* slot) {
+  return slot->loaded_bytes >= slot->bytes || slot->loaded_bytes >= TRACKCACHE_START_BYTES ? 1 : 0;
+}
+
+//
+//  slot to be filled, the current track first
+//
+static TRACK_SLOT* get_fill_slot(TRACK_CACHE* tc) {
+  if (tc->current != NULL && tc->current->loaded_bytes < tc->current->bytes) return tc->current;
+  if (tc->next != NULL && tc->next->loaded_bytes < tc->next->bytes) return tc->next;
+  return NULL;
+}
+
+//
+//  a slot is waiting for data
+//
+int16_t trackcache_is_due(TRACK_CACHE* tc) {
+  return tc->arena != NULL && get_fill_slot(tc) != NULL ? 1 : 0;
+}
+
+//
+//  read the next blocks of the current or the next track, returns number of blocks read
+//  (called from the interrupt handler only while the disk is idle, and from the loader for the first track)
+//
+int16_t trackcache_fill(TRACK_CACHE* tc, REFILL* rf, uint32_t clock_msec, uint32_t played_bytes) {
+
+  int16_t num_read = 0;
+  TRACK_SLOT* slot = get_fill_slot(tc);
+
+  if (slot == NULL) return 0;
+  if (slot->loaded_bytes == 0) slot->load_start_msec = clock_msec;
+
+  while (num_read < TRACKCACHE_FILL_BLOCKS && slot->loaded_bytes < slot->bytes) {
+
+    uint32_t block_bytes = slot->bytes - slot->loaded_bytes;
+    if (block_bytes > TRACKCACHE_BLOCK_BYTES) block_bytes = TRACKCACHE_BLOCK_BYTES;
+
+    // playback of a track started before it was fully loaded already went into this block
+    if (slot == tc->current && played_bytes > slot->loaded_bytes) {
+      tc->underruns++;
+    }
+
+    if (refill_read(rf, slot->source->full_path, slot->loaded_bytes, slot->buffer + slot->loaded_bytes, block_bytes) != block_bytes) break;
+
+    slot->loaded_bytes += block_bytes;
+    num_read++;
+  }
+
+  if (num_read > 0 && slot->loaded_bytes >= slot->bytes) {
+    uint32_t msec = clock_msec - slot->load_start_msec;
+    tc->loads++;
+    tc->load_msec_total += msec;
+    if (msec > tc->load_msec_max) tc->load_msec_max = msec;
+  }
+
+  return num_read;
+}
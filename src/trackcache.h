@@ -0,0 +1,62 @@
+#ifndef __H_TRACKCACHE__
+#define __H_TRACKCACHE__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "stream.h"
+
+#define TRACKCACHE_EYE_CATCH     "Bgp#44pL"
+#define TRACKCACHE_EYE_CATCH_LEN (8)
+
+// the current, the fading out and the next track need a slot each
+#define TRACKCACHE_MIN_SLOTS (3)
+#define TRACKCACHE_MAX_SLOTS (16)
+#define TRACKCACHE_MAX_MB    (1024)
+
+// a few blocks are read per interrupt while DOS is idle (1MB/s at 64msec, several times the playback rate)
+#define TRACKCACHE_BLOCK_BYTES (0x8000)
+#define TRACKCACHE_FILL_BLOCKS (2)
+
+// a track missing in the cache is started when this much of it is loaded, the rest is loaded while it plays
+#define TRACKCACHE_START_BYTES (STREAM_BYTES_PER_SEC * 2)
+
+// one decoded track (the raw .s44 data, played as it is)
+typedef struct {
+  PCM_STREAM* source;         // NULL: empty slot, repeated playlist entries share the source
+  uint8_t* buffer;
+  uint32_t bytes;
+  uint32_t loaded_bytes;
+  uint32_t last_used;         // play sequence number for LRU eviction
+  uint32_t load_start_msec;
+} TRACK_SLOT;
+
+// fixed budget of high memory split into slots of the largest track
+typedef struct {
+  uint8_t eye_catch[ TRACKCACHE_EYE_CATCH_LEN ];
+  uint8_t* arena;
+  uint32_t slot_bytes;
+  int16_t num_slots;
+  uint32_t use_count;
+  TRACK_SLOT* current;
+  TRACK_SLOT* previous;
+  TRACK_SLOT* next;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t loads;
+  uint32_t load_msec_total;
+  uint32_t load_msec_max;
+  uint32_t underruns;
+  TRACK_SLOT slots[ TRACKCACHE_MAX_SLOTS ];
+} TRACK_CACHE;
+
+int32_t trackcache_open(TRACK_CACHE* tc, uint32_t budget_bytes, uint32_t slot_bytes);
+void trackcache_close(TRACK_CACHE* tc);
+TRACK_SLOT* trackcache_find(TRACK_CACHE* tc, PCM_STREAM* source);
+TRACK_SLOT* trackcache_play(TRACK_CACHE* tc, PCM_STREAM* source);
+void trackcache_prefetch(TRACK_CACHE* tc, PCM_STREAM* source);
+int16_t trackcache_is_ready(TRACK_CACHE* tc, PCM_STREAM* source);
+int16_t trackcache_is_playable(TRACK_SLOT* slot);
+int16_t trackcache_is_due(TRACK_CACHE* tc);
+int16_t trackcache_fill(TRACK_CACHE* tc, REFILL* rf, uint32_t clock_msec, uint32_t played_bytes);
+
+#endif
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "dosio.h"
+#include "convert.h"
+#include "wav.h"
+
+// KSDATAFORMAT_SUBTYPE_xxx GUIDs differ only in their first 2 bytes (the format tag)
+static const uint8_t g_subformat_guid_tail[] = {
+  0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71,
+};
+
+//
+//  little endian to native
+//
+static uint32_t read_le32(uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_le16(uint8_t* p) {
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+//
+//  initialize wav handle (parse RIFF header and position the file pointer at the top of data chunk)
+//
+int32_t wav_init(WAV_HANDLE* wav, DOSIO_HANDLE* io, CONVERT_KERNEL* kernel) {
+
+  // default return code
+  int32_t rc = -1;
+
+  // reset attributes
+  if (wav == NULL) goto exit;
+  wav->format = 0;
+  wav->channels = 0;
+  wav->sample_rate = 0;
+  wav->bits_per_sample = 0;
+  wav->block_align = 0;
+  wav->data_offset = 0;
+  wav->data_bytes = 0;
+  wav->read_bytes = 0;
+  wav->kernel = kernel;
+
+  // RIFF header check
+  if (io == NULL) goto exit;
+  uint8_t header[12];
+  if (dosio_read(io, header, 12) != 12) goto exit;
+  if (memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) goto exit;
+
+  // walk through chunks until we find data chunk, only chunk headers are read
+  for (;;) {
+
+    uint8_t chunk[8];
+    if (dosio_read(io, chunk, 8) != 8) goto exit;
+    size_t chunk_bytes = read_le32(chunk + 4);
+
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+
+      // WAVEFORMATEXTENSIBLE has the actual format in the first 2 bytes of its SubFormat GUID
+      uint8_t fmt[ WAV_FMT_EXTENSIBLE_BYTES ];
+      size_t fmt_bytes = chunk_bytes < WAV_FMT_EXTENSIBLE_BYTES ? chunk_bytes : WAV_FMT_EXTENSIBLE_BYTES;
+      if (chunk_bytes < 16) goto exit;
+      if (dosio_read(io, fmt, fmt_bytes) != fmt_bytes) goto exit;
+      wav->format = read_le16(fmt + 0);
+      wav->channels = read_le16(fmt + 2);
+      wav->sample_rate = read_le32(fmt + 4);
+      wav->block_align = read_le16(fmt + 12);
+      wav->bits_per_sample = read_le16(fmt + 14);
+      if (wav->format == WAV_FORMAT_EXTENSIBLE) {
+        // an unknown GUID is left as the extensible tag, which is not supported
+        if (fmt_bytes < WAV_FMT_EXTENSIBLE_BYTES || read_le16(fmt + 16) < 22) goto exit;
+        if (memcmp(fmt + 26, g_subformat_guid_tail, sizeof(g_subformat_guid_tail)) == 0) {
+          wav->format = read_le16(fmt + 24);
+        }
+      }
+
+      // skip extension part and pad byte
+      size_t skip_bytes = chunk_bytes - fmt_bytes + (chunk_bytes & 0x01);
+      if (skip_bytes > 0 && dosio_seek(io, skip_bytes, SEEK_CUR) != 0) goto exit;
+
+    } else if (memcmp(chunk, "data", 4) == 0) {
+
+      // fmt chunk must come first
+      if (wav->channels == 0) goto exit;
+
+      wav->data_offset = dosio_tell(io);
+      wav->data_bytes = chunk_bytes;
+
+      // some writers leave the data chunk size as 0 or 0xffffffff, trust the actual file size in that case
+      size_t file_bytes = dosio_get_size(io);
+      if (wav->data_bytes == 0 || wav->data_offset + wav->data_bytes > file_bytes) {
+        wav->data_bytes = file_bytes - wav->data_offset;
+      }
+      break;
+
+    } else {
+
+      // skip unknown chunk (LIST, fact, etc.)
+      if (dosio_seek(io, chunk_bytes + (chunk_bytes & 0x01), SEEK_CUR) != 0) goto exit;
+
+    }
+  }
+
+  rc = 0;
+
+exit:
+  return rc;
+}
+
+//
+//  check if the wav data can be loaded (16bit linear PCM, 22.05kHz to 48kHz, mono or stereo,
+//  also as an extensible format whose SubFormat is PCM, samples packed without padding)
+//
+int32_t wav_is_supported(WAV_HANDLE* wav) {
+  return wav->format == WAV_FORMAT_PCM && wav->bits_per_sample == 16 &&
+         wav->sample_rate >= 22050 && wav->sample_rate <= 48000 &&
+         (wav->channels == 1 || wav->channels == 2) && wav->block_align == wav->channels * 2 ? 1 : 0;
+}
+
+//
+//  data length in 16bit stereo unit (the same unit as raw .s44 data)
+//
+size_t wav_get_data_len(WAV_HANDLE* wav) {
+  return wav->data_bytes / sizeof(int16_t) * (3 - wav->channels);
+}
+
+//
+//  read wav data into the staging buffer and store them as native order 16bit stereo words into dst
+//  (dst can be the same as buffer, mono data are expanded to stereo from the tail)
+//
+size_t wav_read(WAV_HANDLE* wav, DOSIO_HANDLE* io, int16_t* buffer, int16_t* dst, size_t len) {
+
+  // do not read beyond the data chunk
+  size_t read_len = len / (3 - wav->channels);
+  size_t remain_len = (wav->data_bytes - wav->read_bytes) / sizeof(int16_t);
+  if (read_len > remain_len) read_len = remain_len;
+  if (read_len == 0) return 0;
+
+  size_t n = dosio_read(io, buffer, read_len * sizeof(int16_t)) / sizeof(int16_t);
+  wav->read_bytes += n * sizeof(int16_t);
+
+  if (wav->channels == 2) {
+    wav->kernel->swap_words(dst, buffer, n);
+    return n;
+  }
+
+  // mono to stereo with byte swap
+  uint16_t* s = (uint16_t*)buffer + n;
+  uint16_t* d = (uint16_t*)dst + n * 2;
+  for (size_t i = 0; i < n; i++) {
+    uint16_t v = *(--s);
+    v = (uint16_t)((v << 8) | (v >> 8));
+    *(--d) = v;
+    *(--d) = v;
+  }
+
+  return n * 2;
+}
@@ -0,0 +1,33 @@
+#ifndef __H_WAV__
+#define __H_WAV__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "dosio.h"
+#include "convert.h"
+
+#define WAV_FORMAT_PCM        (0x0001)
+#define WAV_FORMAT_EXTENSIBLE (0xfffe)
+
+// fmt chunk bytes up to the SubFormat GUID of WAVEFORMATEXTENSIBLE
+#define WAV_FMT_EXTENSIBLE_BYTES (40)
+
+typedef struct {
+  uint16_t format;          // WAV_FORMAT_PCM also for an extensible format of PCM SubFormat
+  int16_t channels;
+  int32_t sample_rate;
+  int16_t bits_per_sample;
+  int16_t block_align;
+  size_t data_offset;
+  size_t data_bytes;
+  size_t read_bytes;
+  CONVERT_KERNEL* kernel;   // word swap of the data for this CPU
+} WAV_HANDLE;
+
+int32_t wav_init(WAV_HANDLE* wav, DOSIO_HANDLE* io, CONVERT_KERNEL* kernel);
+int32_t wav_is_supported(WAV_HANDLE* wav);
+size_t wav_get_data_len(WAV_HANDLE* wav);
+size_t wav_read(WAV_HANDLE* wav, DOSIO_HANDLE* io, int16_t* buffer, int16_t* dst, size_t len);
+
+#endif
@@ -13,6 +13,7 @@
 		.xdef	atop_mem
 		.xdef	atop_set
 		.xdef	atop_null_exec
+		.xdef	atop_exec_work
 
 		.offset	0
 free_head:
@@ -236,6 +237,23 @@ atop_exec:
 	pop	d0-a6
 	rts
 
+atop_exec_work:
+	* ADPCM->PCM with the work area of the caller (reentrant version of atop_exec,
+	* each stream keeps stereo, x1/rx1/lx1 and back/rback/lback in its own area)
+	* d0: bytes to convert, a0: ADPCM buffer, a1: PCM buffer, a2: work area
+	push	d0-a6
+	movea.l	a2,a6
+	move.l	a0,ada_add(a6)
+	move.l	a1,pcma_add(a6)
+	tst.w	stereo(a6)
+	bne	@f
+	bsr	conv_mono
+	pop	d0-a6
+	rts
+@@:	bsr	conv_stereo
+	pop	d0-a6
+	rts
+
 MAKE_BUFFER:
 		MOVEQ	#0,D7
 		MOVEQ	#16,D6
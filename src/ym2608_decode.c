@@ -2,8 +2,30 @@
 #include <stdint.h>
 #include <string.h>
 #include "himem.h"
+#include "profile.h"
 #include "ym2608_decode.h"
 
+// work area layout of ym2608_adpcmlib.s (stereo is tested as the upper word)
+typedef struct {
+  int16_t stereo;
+  int16_t stereo_low;
+  uint8_t* cnva_add;
+  int16_t* pcma_add;
+  uint8_t* ada_add;
+  int32_t x, y, rx, ry, lx, ly;
+  uint8_t* x1;
+  uint8_t* rx1;
+  uint8_t* lx1;
+  void* ra;
+  void* la;
+  int32_t rback;
+  int32_t lback;
+  int32_t back;
+} ADPCMLIB_WORK;
+
+// free_head..free_tail of ym2608_adpcmlib.s, 18 longs
+_Static_assert(sizeof(ADPCMLIB_WORK) == ADPCMLIB_WORK_SIZE, "ADPCMLIB_WORK does not match the work area of ym2608_adpcmlib.s");
+
 //
 //  init ADPCM(YM2608) decoder handle
 //
@@ -19,6 +41,8 @@ int32_t ym2608_decode_init(YM2608_DECODE_HANDLE* nas, size_t decode_buffer_len,
   nas->channels = channels;
   nas->resample_counter = 0;
   nas->conv_table = NULL;
+  nas->decode_time = 0;
+  nas->decode_bytes = 0;
  
   // buffer allocation
   nas->decode_buffer = himem_malloc(nas->decode_buffer_len * sizeof(int16_t), 0);
@@ -36,13 +60,7 @@ int32_t ym2608_decode_init(YM2608_DECODE_HANDLE* nas, size_t decode_buffer_len,
     :                   // clobbered register
   );
 
-  register uint32_t reg_d0 asm ("d0") = (uint32_t)(nas->channels == 1 ? 0 : 1);
-  asm volatile (
-    "jbsr  atop_init\n"
-    :                   // output operand
-    : "r" (reg_d0)      // input operand
-    :                   // clobbered register
-  );
+  ym2608_decode_reset(nas);
 
   rc = 0;
 
@@ -65,34 +83,87 @@ void ym2608_decode_close(YM2608_DECODE_HANDLE* nas) {
 }
 
 //
-//  decode ADPCM (YM2608) stream into the specified buffer
+//  start a new stream (the conversion table position at the top and no last sample)
 //
-size_t ym2608_decode_exec_buffer(YM2608_DECODE_HANDLE* nas, uint8_t* adpcm_data, size_t adpcm_data_bytes, int16_t* decode_buffer, size_t decode_buffer_len) {
+void ym2608_decode_reset(YM2608_DECODE_HANDLE* nas) {
+  ADPCMLIB_WORK* w = (ADPCMLIB_WORK*)nas->work_area;
+  memset(w, 0, sizeof(ADPCMLIB_WORK));
+  w->stereo = nas->channels == 1 ? 0 : 1;
+  w->cnva_add = nas->conv_table;
+  w->x1 = w->rx1 = w->lx1 = nas->conv_table;
+}
 
-  // check decode buffer size
-  if (adpcm_data_bytes * 4 / sizeof(int16_t) > decode_buffer_len) return 0;
+//
+//  save the decoder state (between two calls of exec)
+//
+void ym2608_decode_save(YM2608_DECODE_HANDLE* nas, YM2608_DECODE_STATE* state) {
+  ADPCMLIB_WORK* w = (ADPCMLIB_WORK*)nas->work_area;
+  if (w->stereo) {
+    state->value[0] = w->rback;
+    state->value[1] = w->lback;
+    state->step[0] = w->rx1 - nas->conv_table;
+    state->step[1] = w->lx1 - nas->conv_table;
+  } else {
+    state->value[0] = state->value[1] = w->back;
+    state->step[0] = state->step[1] = w->x1 - nas->conv_table;
+  }
+}
 
-  // decode NAS ADPCM
-  register uint32_t reg_d0 asm ("d0") = (uint32_t)(adpcm_data_bytes);
+//
+//  restore a saved decoder state, decoding goes on from where it was saved
+//
+void ym2608_decode_restore(YM2608_DECODE_HANDLE* nas, const YM2608_DECODE_STATE* state) {
+  ADPCMLIB_WORK* w = (ADPCMLIB_WORK*)nas->work_area;
+  if (w->stereo) {
+    w->rback = state->value[0];
+    w->lback = state->value[1];
+    w->rx1 = nas->conv_table + state->step[0];
+    w->lx1 = nas->conv_table + state->step[1];
+  } else {
+    w->back = state->value[0];
+    w->x1 = nas->conv_table + state->step[0];
+  }
+}
+
+//
+//  decode ADPCM (YM2608) stream into the specified buffer, as many bytes (byte pairs in stereo) as the buffer takes
+//  (the bytes decoded are returned in used_bytes, the rest is given to the next call)
+//
+size_t ym2608_decode_exec_buffer(YM2608_DECODE_HANDLE* nas, uint8_t* adpcm_data, size_t adpcm_data_bytes, int16_t* decode_buffer, size_t decode_buffer_len, size_t* used_bytes) {
+
+  // partial output when the decode buffer is short
+  size_t bytes = decode_buffer_len * sizeof(int16_t) / 4;
+  if (bytes > adpcm_data_bytes) bytes = adpcm_data_bytes;
+  if (nas->channels != 1) bytes &= ~0x01;
+  if (used_bytes != NULL) *used_bytes = bytes;
+  if (bytes == 0) return 0;
+
+  // decode NAS ADPCM with the work area of this handle
+  register uint32_t reg_d0 asm ("d0") = (uint32_t)(bytes);
   register uint32_t reg_a0 asm ("a0") = (uint32_t)(adpcm_data);
   register uint32_t reg_a1 asm ("a1") = (uint32_t)(decode_buffer);
+  register uint32_t reg_a2 asm ("a2") = (uint32_t)(nas->work_area);
   asm volatile (
-    "jbsr  atop_exec\n"
+    "jbsr  atop_exec_work\n"
     :                   // output operand
     : "r" (reg_d0),     // input operand
       "r" (reg_a0),     // input operand
-      "r" (reg_a1)      // input operand
-    :                   // clobbered register
+      "r" (reg_a1),     // input operand
+      "r" (reg_a2)      // input operand
+    : "memory"          // clobbered register
   );
 
-  return adpcm_data_bytes * 4 / sizeof(int16_t);
+  return bytes * 4 / sizeof(int16_t);
 }
 
 //
 //  decode ADPCM (YM2608) stream into the decoder instance buffer
 //
 size_t ym2608_decode_exec(YM2608_DECODE_HANDLE* nas, uint8_t* adpcm_data, size_t adpcm_data_bytes) {
-  nas->decode_buffer_ofs = 
-    ym2608_decode_exec_buffer(nas, adpcm_data, adpcm_data_bytes, nas->decode_buffer, nas->decode_buffer_len);
+  uint32_t t0 = profile_get_usec();
+  nas->decode_buffer_ofs =
+    ym2608_decode_exec_buffer(nas, adpcm_data, adpcm_data_bytes, nas->decode_buffer, nas->decode_buffer_len, NULL);
+  nas->decode_time += profile_get_usec() - t0;
+  nas->decode_bytes += nas->decode_buffer_ofs * sizeof(int16_t);
   return nas->decode_buffer_ofs;
 }
@@ -7,6 +7,15 @@
 
 #define ADPCMLIB_CONV_TABLE_SIZE (141312)
 
+// work area of one stream (the .offset block of ym2608_adpcmlib.s, the C decoder of the host build uses a part of it)
+#define ADPCMLIB_WORK_SIZE (72)
+
+// decoder state to resume a stream at (valid for handles of the same build)
+typedef struct {
+  int32_t value[2];         // last sample of each channel
+  int32_t step[2];          // step size state (offset in the conversion table, step index in the C decoder)
+} YM2608_DECODE_STATE;
+
 typedef struct {
 
   int32_t sample_rate;
@@ -20,11 +29,19 @@ typedef struct {
 
   uint8_t* conv_table;
 
+  int32_t work_area[ ADPCMLIB_WORK_SIZE / sizeof(int32_t) ];
+
+  uint32_t decode_time;     // in usec
+  size_t decode_bytes;
+
 } YM2608_DECODE_HANDLE;
 
 int32_t ym2608_decode_init(YM2608_DECODE_HANDLE* nas, size_t decode_buffer_bytes, int32_t sample_rate, int16_t channels);
 void ym2608_decode_close(YM2608_DECODE_HANDLE* nas);
-size_t ym2608_decode_exec_buffer(YM2608_DECODE_HANDLE* nas, uint8_t* adpcm_data, size_t adpcm_data_bytes, int16_t* decode_buffer, size_t decode_buffer_len);
+void ym2608_decode_reset(YM2608_DECODE_HANDLE* nas);
+void ym2608_decode_save(YM2608_DECODE_HANDLE* nas, YM2608_DECODE_STATE* state);
+void ym2608_decode_restore(YM2608_DECODE_HANDLE* nas, const YM2608_DECODE_STATE* state);
+size_t ym2608_decode_exec_buffer(YM2608_DECODE_HANDLE* nas, uint8_t* adpcm_data, size_t adpcm_data_bytes, int16_t* decode_buffer, size_t decode_buffer_len, size_t* used_bytes);
 size_t ym2608_decode_exec(YM2608_DECODE_HANDLE* nas, uint8_t* adpcm_data, size_t adpcm_data_bytes);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "himem.h"
+#include "dosio.h"
+#include "profile.h"
+#include "sample.h"
+#include "z44.h"
+
+//
+//  big endian to native
+//
+static uint32_t read_be32(uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint16_t read_be16(uint8_t* p) {
+  return ((uint16_t)p[0] << 8) | (uint16_t)p[1];
+}
+
+//
+//  initialize z44 handle (read header and block index, the file pointer is left at the first block)
+//
+int32_t z44_init(Z44_HANDLE* z44, DOSIO_HANDLE* io) {
+
+  // default return code
+  int32_t rc = -1;
+
+  // reset attributes
+  if (z44 == NULL) goto exit;
+  z44->num_frames = 0;
+  z44->block_frames = 0;
+  z44->num_blocks = 0;
+  z44->current_block = 0;
+  z44->block_bytes = NULL;
+  z44->decode_time = 0;
+  z44->decode_bytes = 0;
+
+  // header check
+  if (io == NULL) goto exit;
+  uint8_t header[ Z44_HEADER_BYTES ];
+  if (dosio_read(io, header, Z44_HEADER_BYTES) != Z44_HEADER_BYTES) goto exit;
+  if (memcmp(header, Z44_EYE_CATCH, 4) != 0) goto exit;
+  if (read_be16(header + 4) != Z44_VERSION || read_be16(header + 6) != 2) goto exit;
+
+  z44->num_frames = read_be32(header + 8);
+  z44->block_frames = read_be32(header + 12);
+  if (z44->block_frames == 0 || z44->block_frames > Z44_BLOCK_FRAMES) goto exit;
+  z44->num_blocks = z44->num_frames / z44->block_frames + (z44->num_frames % z44->block_frames != 0);
+
+  // the frame count is not trusted, the block index and every block (at least 1 byte) must be in the file
+  size_t file_bytes = dosio_get_size(io);
+  if (file_bytes < Z44_HEADER_BYTES || z44->num_blocks > (file_bytes - Z44_HEADER_BYTES) / 5) goto exit;
+
+  // block index (read as a whole and converted in place)
+  z44->block_bytes = himem_malloc(sizeof(uint32_t) * (z44->num_blocks + 1), 0);
+  if (z44->block_bytes == NULL) goto exit;
+  size_t index_bytes = sizeof(uint32_t) * z44->num_blocks;
+  if (dosio_read(io, z44->block_bytes, index_bytes) != index_bytes) goto exit;
+  size_t data_bytes = file_bytes - Z44_HEADER_BYTES - index_bytes;
+  for (uint32_t i = 0; i < z44->num_blocks; i++) {
+    z44->block_bytes[i] = read_be32((uint8_t*)&(z44->block_bytes[i]));
+    if (z44->block_bytes[i] == 0 || z44->block_bytes[i] > Z44_MAX_BLOCK_BYTES) goto exit;
+    if (z44->block_bytes[i] > data_bytes) goto exit;
+    data_bytes -= z44->block_bytes[i];
+  }
+
+  rc = 0;
+
+exit:
+  return rc;
+}
+
+//
+//  close z44 handle
+//
+void z44_close(Z44_HANDLE* z44) {
+  if (z44->block_bytes != NULL) {
+    himem_free(z44->block_bytes, 0);
+    z44->block_bytes = NULL;
+  }
+}
+
+//
+//  decoded data length in 16bit unit (the same unit as raw .s44 data)
+//
+size_t z44_get_data_len(Z44_HANDLE* z44) {
+  return z44->num_frames * 2;
+}
+
+//
+//  read as many whole blocks as fit both in the staging buffer and in len, and decode them into dst
+//  (one large read per call, returns decoded length in 16bit unit)
+//
+size_t z44_read(Z44_HANDLE* z44, DOSIO_HANDLE* io, uint8_t* buffer, size_t buffer_bytes, int16_t* dst, size_t len) {
+
+  // how many blocks we can handle at once
+  uint32_t first_block = z44->current_block;
+  uint32_t last_block = first_block;
+  size_t read_bytes = 0;
+  size_t decode_len = 0;
+  while (last_block < z44->num_blocks) {
+    size_t frames = (last_block == z44->num_blocks - 1) ? z44->num_frames - last_block * z44->block_frames : z44->block_frames;
+    if (read_bytes + z44->block_bytes[ last_block ] + 4 > buffer_bytes) break;
+    if (decode_len + frames * 2 > len) break;
+    read_bytes += z44->block_bytes[ last_block ];
+    decode_len += frames * 2;
+    last_block++;
+  }
+  if (last_block == first_block) return 0;
+
+  if (dosio_read(io, buffer, read_bytes) != read_bytes) return 0;
+
+  // decode
+  uint32_t t0 = profile_get_usec();
+  uint8_t* block = buffer;
+  int16_t* d = dst;
+  for (uint32_t i = first_block; i < last_block; i++) {
+    size_t frames = (i == z44->num_blocks - 1) ? z44->num_frames - i * z44->block_frames : z44->block_frames;
+    d += z44_decode_block(block, frames, d);
+    block += z44->block_bytes[i];
+  }
+  z44->current_block = last_block;
+  z44->decode_time += profile_get_usec() - t0;
+  z44->decode_bytes += (d - dst) * sizeof(int16_t);
+
+  return d - dst;
+}
+
+//
+//  decode a block into 16bit stereo words in PCM memory order
+//  (the bit reader may look ahead up to 4 bytes beyond the block)
+//
+size_t z44_decode_block(uint8_t* block, size_t frames, int16_t* dst) {
+
+  if (block[0] == Z44_BLOCK_RAW) {
+    memcpy(dst, block + 1, frames * 4);
+    return frames * 2;
+  }
+
+  int16_t k_l = block[1];
+  int16_t k_s = block[2];
+  int32_t l = (int16_t)read_be16(block + 4);
+  int32_t s = (int16_t)read_be16(block + 6);
+  dst[0] = SAMPLE((int16_t)l);
+  dst[1] = SAMPLE((int16_t)(l + s));
+
+  // left aligned bit buffer
+  uint8_t* p = block + 8;
+  uint32_t bits = 0;
+  int16_t num_bits = 0;
+
+  for (size_t i = 1; i < frames; i++) {
+    for (int16_t c = 0; c < 2; c++) {
+
+      // refill up to 25 valid bits
+      while (num_bits <= 24) {
+        bits |= (uint32_t)(*p++) << (24 - num_bits);
+        num_bits += 8;
+      }
+
+      // unary part
+      int16_t q = 0;
+      while ((bits & 0x80000000) && q < Z44_RICE_ESCAPE) {
+        bits <<= 1;
+        num_bits--;
+        q++;
+      }
+
+      uint32_t z;
+      if (q == Z44_RICE_ESCAPE) {
+        // escaped raw value
+        while (num_bits <= 24) {
+          bits |= (uint32_t)(*p++) << (24 - num_bits);
+          num_bits += 8;
+        }
+        z = bits >> (32 - Z44_ESCAPE_BITS);
+        bits <<= Z44_ESCAPE_BITS;
+        num_bits -= Z44_ESCAPE_BITS;
+      } else {
+        // stop bit and remainder
+        bits <<= 1;
+        num_bits--;
+        int16_t k = c == 0 ? k_l : k_s;
+        if (k > 0) {
+          if (num_bits < k) {
+            while (num_bits <= 24) {
+              bits |= (uint32_t)(*p++) << (24 - num_bits);
+              num_bits += 8;
+            }
+          }
+          z = ((uint32_t)q << k) | (bits >> (32 - k));
+          bits <<= k;
+          num_bits -= k;
+        } else {
+          z = q;
+        }
+      }
+
+      // zigzag to signed delta
+      int32_t delta = (z & 0x01) ? -(int32_t)((z + 1) >> 1) : (int32_t)(z >> 1);
+      if (c == 0) {
+        l += delta;
+      } else {
+        s += delta;
+      }
+    }
+
+    dst[ i * 2 + 0 ] = SAMPLE((int16_t)l);
+    dst[ i * 2 + 1 ] = SAMPLE((int16_t)(l + s));
+  }
+
+  return frames * 2;
+}
+
+//
+//  bit writer for the encoder
+//
+typedef struct {
+  uint8_t* p;
+  uint32_t bits;
+  int16_t num_bits;
+} BIT_WRITER;
+
+static void put_bits(BIT_WRITER* w, uint32_t v, int16_t n) {
+  for (int16_t i = n - 1; i >= 0; i--) {
+    w->bits = (w->bits << 1) | ((v >> i) & 0x01);
+    w->num_bits++;
+    if (w->num_bits == 8) {
+      *(w->p++) = (uint8_t)w->bits;
+      w->bits = 0;
+      w->num_bits = 0;
+    }
+  }
+}
+
+static void flush_bits(BIT_WRITER* w) {
+  if (w->num_bits > 0) {
+    *(w->p++) = (uint8_t)(w->bits << (8 - w->num_bits));
+    w->bits = 0;
+    w->num_bits = 0;
+  }
+}
+
+//
+//  choose rice parameter from the mean of zigzag values
+//
+static int16_t rice_param(uint32_t sum, size_t count) {
+  int16_t k = 0;
+  while (k < Z44_MAX_RICE_PARAM && ((uint32_t)count << (k + 1)) < sum) k++;
+  return k;
+}
+
+//
+//  encode 16bit stereo words in PCM memory order into a block (block must have Z44_MAX_BLOCK_BYTES),
+//  returns block bytes
+//  this is only used by host side conversion tools
+//
+size_t z44_encode_block(int16_t* src, size_t frames, uint8_t* block) {
+
+  // choose rice parameters
+  uint32_t sum_l = 0;
+  uint32_t sum_s = 0;
+  for (size_t i = 1; i < frames; i++) {
+    int32_t dl = (int32_t)SAMPLE(src[ i * 2 ]) - SAMPLE(src[ i * 2 - 2 ]);
+    int32_t ds = ((int32_t)SAMPLE(src[ i * 2 + 1 ]) - SAMPLE(src[ i * 2 ])) - ((int32_t)SAMPLE(src[ i * 2 - 1 ]) - SAMPLE(src[ i * 2 - 2 ]));
+    sum_l += dl < 0 ? -dl * 2 - 1 : dl * 2;
+    sum_s += ds < 0 ? -ds * 2 - 1 : ds * 2;
+  }
+  int16_t k_l = rice_param(sum_l, frames);
+  int16_t k_s = rice_param(sum_s, frames);
+
+  block[0] = Z44_BLOCK_RICE;
+  block[1] = (uint8_t)k_l;
+  block[2] = (uint8_t)k_s;
+  block[3] = 0;
+  block[4] = (uint8_t)((uint16_t)SAMPLE(src[0]) >> 8);
+  block[5] = (uint8_t)SAMPLE(src[0]);
+  int16_t s0 = (int16_t)(SAMPLE(src[1]) - SAMPLE(src[0]));
+  block[6] = (uint8_t)((uint16_t)s0 >> 8);
+  block[7] = (uint8_t)s0;
+
+  BIT_WRITER w = { block + 8, 0, 0 };
+  size_t raw_bytes = 1 + frames * 4;
+  int32_t l = SAMPLE(src[0]);
+  int32_t s = s0;
+
+  for (size_t i = 1; i < frames; i++) {
+    int32_t nl = SAMPLE(src[ i * 2 ]);
+    int32_t ns = (int16_t)(SAMPLE(src[ i * 2 + 1 ]) - SAMPLE(src[ i * 2 ]));
+    for (int16_t c = 0; c < 2; c++) {
+      int32_t delta = c == 0 ? nl - l : ns - s;
+      uint32_t z = delta < 0 ? (uint32_t)(-delta) * 2 - 1 : (uint32_t)delta * 2;
+      int16_t k = c == 0 ? k_l : k_s;
+      uint32_t q = z >> k;
+      if (q >= Z44_RICE_ESCAPE) {
+        put_bits(&w, 0xffffffff, Z44_RICE_ESCAPE);
+        put_bits(&w, z, Z44_ESCAPE_BITS);
+      } else {
+        for (uint32_t j = 0; j < q; j++) put_bits(&w, 1, 1);
+        put_bits(&w, 0, 1);
+        put_bits(&w, z, k);
+      }
+    }
+    l = nl;
+    s = ns;
+
+    // give up compression, store as raw
+    if ((size_t)(w.p - block) >= raw_bytes) break;
+  }
+  flush_bits(&w);
+
+  if ((size_t)(w.p - block) >= raw_bytes) {
+    block[0] = Z44_BLOCK_RAW;
+    uint8_t* p = block + 1;
+    for (size_t i = 0; i < frames * 2; i++) {
+      *p++ = (uint8_t)((uint16_t)src[i] >> 8);
+      *p++ = (uint8_t)src[i];
+    }
+    return raw_bytes;
+  }
+
+  return w.p - block;
+}
@@ -0,0 +1,55 @@
+#ifndef __H_Z44__
+#define __H_Z44__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "dosio.h"
+
+//
+//  .z44 - lossless compressed .s44 (44.1kHz 16bit stereo big endian)
+//
+//  header (big endian)
+//    +0  "Z44",0x1a
+//    +4  version (16bit), channels (16bit, always 2)
+//    +8  number of frames (32bit)
+//    +12 frames per block (32bit)
+//    +16 block index, compressed bytes of each block (32bit x number of blocks)
+//  block
+//    +0  mode (Z44_BLOCK_RAW or Z44_BLOCK_RICE)
+//    raw:  big endian 16bit stereo samples
+//    rice: +1 rice parameter of L, +2 rice parameter of R-L, +3 reserved,
+//          +4 first L and R-L (16bit each), then bit stream of the rest frame deltas
+//          (zigzag mapped, L and R-L interleaved, MSB first)
+//
+#define Z44_EYE_CATCH      "Z44\x1a"
+#define Z44_VERSION        (1)
+#define Z44_HEADER_BYTES   (16)
+#define Z44_BLOCK_FRAMES   (4096)
+#define Z44_BLOCK_RAW      (0)
+#define Z44_BLOCK_RICE     (1)
+#define Z44_RICE_ESCAPE    (24)
+#define Z44_ESCAPE_BITS    (18)
+#define Z44_MAX_RICE_PARAM (16)
+
+// worst case compressed block bytes (raw block + mode byte + bit stream read margin)
+#define Z44_MAX_BLOCK_BYTES (Z44_BLOCK_FRAMES * 4 + 16)
+
+typedef struct {
+  uint32_t num_frames;
+  uint32_t block_frames;
+  uint32_t num_blocks;
+  uint32_t current_block;
+  uint32_t* block_bytes;
+  uint32_t decode_time;     // in usec
+  size_t decode_bytes;
+} Z44_HANDLE;
+
+int32_t z44_init(Z44_HANDLE* z44, DOSIO_HANDLE* io);
+void z44_close(Z44_HANDLE* z44);
+size_t z44_get_data_len(Z44_HANDLE* z44);
+size_t z44_read(Z44_HANDLE* z44, DOSIO_HANDLE* io, uint8_t* buffer, size_t buffer_bytes, int16_t* dst, size_t len);
+size_t z44_decode_block(uint8_t* block, size_t frames, int16_t* dst);
+size_t z44_encode_block(int16_t* src, size_t frames, uint8_t* block);
+
+#endif
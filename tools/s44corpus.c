@@ -0,0 +1,163 @@
+//
+//  s44corpus - deterministic synthetic corpus for load benchmarks (host PCs)
+//
+//  build: gcc -O2 -o s44corpus s44corpus.c
+//  usage: s44corpus <output directory> [seconds]
+//
+//  The same seconds always give the same bytes (integer generators only, no libm):
+//    corpus.s44  44.1kHz 16bit stereo big endian, triangle sweep with noise
+//    corpus.wav  22.05kHz 16bit stereo RIFF of the same signal
+//    corpus.a44  YM2608 ADPCM stereo random nibbles (the decoder cost does not depend on the signal)
+//    corpus.kmd  KMD100 with tags and an event every 100msec
+//    corpus.lst  indirect file of the corpus
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PATH_LEN (256)
+
+static uint32_t g_seed;
+static uint32_t g_phase[2];
+
+//
+//  restart the generators
+//
+static void reset_generators(void) {
+  g_seed = 44100;
+  g_phase[0] = g_phase[1] = 0;
+}
+
+//
+//  linear congruential generator (upper 16 bits)
+//
+static uint16_t lcg(void) {
+  g_seed = g_seed * 1103515245 + 12345;
+  return (uint16_t)(g_seed >> 16);
+}
+
+//
+//  triangle wave sweeping from 110Hz to 1760Hz over the whole length with -20dB noise
+//
+static int16_t make_sample(uint32_t frame, uint32_t num_frames, int16_t channel) {
+  uint32_t freq = 110 + 1650 * (uint64_t)frame / num_frames + channel * 3;
+  g_phase[ channel ] += (uint32_t)(freq * 65536ULL * 65536ULL / 44100);
+  uint16_t p = g_phase[ channel ] >> 16;
+  int32_t tri = p < 0x8000 ? (int32_t)p * 2 - 0x8000 : 0x17fff - (int32_t)p * 2;
+  int32_t v = tri * 3 / 4 + ((int16_t)lcg() / 10);
+  return v > 32767 ? 32767 : v < -32768 ? -32768 : v;
+}
+
+static void write_be16(FILE* fp, uint16_t v) {
+  fputc(v >> 8, fp);
+  fputc(v & 0xff, fp);
+}
+
+static void write_le16(FILE* fp, uint16_t v) {
+  fputc(v & 0xff, fp);
+  fputc(v >> 8, fp);
+}
+
+static void write_le32(FILE* fp, uint32_t v) {
+  write_le16(fp, v & 0xffff);
+  write_le16(fp, v >> 16);
+}
+
+static FILE* create_file(const char* dir, const char* name) {
+  static char path[ MAX_PATH_LEN ];
+  snprintf(path, MAX_PATH_LEN, "%s/%s", dir, name);
+  FILE* fp = fopen(path, "wb");
+  if (fp == NULL) {
+    printf("error: file create error. (%s)\n", path);
+  }
+  return fp;
+}
+
+//
+//  main
+//
+int main(int argc, char* argv[]) {
+
+  int32_t rc = -1;
+  FILE* fp = NULL;
+
+  if (argc < 2) {
+    printf("usage: s44corpus <output directory> [seconds]\n");
+    goto exit;
+  }
+
+  const char* dir = argv[1];
+  uint32_t secs = argc >= 3 ? atoi(argv[2]) : 20;
+  if (secs < 1 || secs > 600) {
+    printf("error: seconds out of range. (1-600)\n");
+    goto exit;
+  }
+
+  // .s44
+  uint32_t num_frames = 44100 * secs;
+  reset_generators();
+  if ((fp = create_file(dir, "corpus.s44")) == NULL) goto exit;
+  for (uint32_t i = 0; i < num_frames; i++) {
+    write_be16(fp, make_sample(i, num_frames, 0));
+    write_be16(fp, make_sample(i, num_frames, 1));
+  }
+  fclose(fp);
+
+  // .wav (every other frame of the same signal)
+  reset_generators();
+  if ((fp = create_file(dir, "corpus.wav")) == NULL) goto exit;
+  uint32_t data_bytes = num_frames / 2 * 4;
+  fwrite("RIFF", 1, 4, fp);
+  write_le32(fp, 36 + data_bytes);
+  fwrite("WAVEfmt ", 1, 8, fp);
+  write_le32(fp, 16);
+  write_le16(fp, 1);
+  write_le16(fp, 2);
+  write_le32(fp, 22050);
+  write_le32(fp, 22050 * 4);
+  write_le16(fp, 4);
+  write_le16(fp, 16);
+  fwrite("data", 1, 4, fp);
+  write_le32(fp, data_bytes);
+  for (uint32_t i = 0; i < num_frames / 2 * 2; i++) {
+    int16_t l = make_sample(i, num_frames, 0);
+    int16_t r = make_sample(i, num_frames, 1);
+    if (i & 0x01) continue;
+    write_le16(fp, l);
+    write_le16(fp, r);
+  }
+  fclose(fp);
+
+  // .a44 (4 bits per sample, 44.1kHz stereo)
+  reset_generators();
+  if ((fp = create_file(dir, "corpus.a44")) == NULL) goto exit;
+  for (uint32_t i = 0; i < num_frames; i++) {
+    fputc(lcg() & 0xff, fp);
+  }
+  fclose(fp);
+
+  // .kmd
+  if ((fp = create_file(dir, "corpus.kmd")) == NULL) goto exit;
+  fprintf(fp, "KMD100\n");
+  fprintf(fp, "x0,y0,s99:59:99,e99:59:99,\"TIT2:s44bgp benchmark corpus\"\n");
+  fprintf(fp, "x0,y0,s99:59:99,e99:59:99,\"TPE1:s44corpus\"\n");
+  fprintf(fp, "x0,y0,s99:59:99,e99:59:99,\"TALB:%d seconds\"\n", secs);
+  for (uint32_t t = 0; t < secs * 1000; t += 100) {
+    uint32_t e = t + 100;
+    fprintf(fp, "x%d,y%d,s%02d:%02d:%02d,e%02d:%02d:%02d,\"event %d at %d msec\"\n", (t / 100) % 30, (t / 100) % 3,
+      t / 60000, t / 1000 % 60, t / 10 % 100, e / 60000, e / 1000 % 60, e / 10 % 100, t / 100, t);
+  }
+  fclose(fp);
+
+  // indirect file
+  if ((fp = create_file(dir, "corpus.lst")) == NULL) goto exit;
+  fprintf(fp, "corpus.s44\ncorpus.wav\ncorpus.a44\n");
+  fclose(fp);
+  fp = NULL;
+
+  rc = 0;
+
+exit:
+  return rc;
+}
@@ -0,0 +1,245 @@
+//
+//  z44conv - .s44 <-> .z44 (lossless compressed .s44) converter for host PCs
+//
+//  build: gcc -O2 -I../src -o z44conv z44conv.c ../src/z44.c
+//  (himem, dosio and profile are replaced by host versions below)
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "z44.h"
+
+//
+//  himem.h replacement for host builds
+//
+void* himem_malloc(size_t size, int32_t use_high_memory) {
+  return malloc(size);
+}
+
+void himem_free(void* ptr, int32_t use_high_memory) {
+  free(ptr);
+}
+
+//
+//  profile.h replacement for host builds (no timing)
+//
+uint32_t profile_get_usec(void) {
+  return 0;
+}
+
+//
+//  dosio.h replacement for host builds (DOSIO_HANDLE fd is an index of host_files)
+//
+static FILE* host_files[ 8 ];
+
+int32_t dosio_open(DOSIO_HANDLE* io, const uint8_t* file_name) {
+  memset(io, 0, sizeof(DOSIO_HANDLE));
+  for (int32_t fd = 0; fd < 8; fd++) {
+    if (host_files[ fd ] == NULL) {
+      host_files[ fd ] = fopen((const char*)file_name, "rb");
+      if (host_files[ fd ] == NULL) return -1;
+      fseek(host_files[ fd ], 0, SEEK_END);
+      io->file_bytes = ftell(host_files[ fd ]);
+      fseek(host_files[ fd ], 0, SEEK_SET);
+      io->fd = fd;
+      io->opened = 1;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+void dosio_close(DOSIO_HANDLE* io) {
+  if (io->opened) {
+    fclose(host_files[ io->fd ]);
+    host_files[ io->fd ] = NULL;
+    io->opened = 0;
+  }
+}
+
+size_t dosio_read(DOSIO_HANDLE* io, void* buffer, size_t bytes) {
+  size_t n = fread(buffer, 1, bytes, host_files[ io->fd ]);
+  io->file_ofs += n;
+  io->read_bytes += n;
+  io->read_calls++;
+  return n;
+}
+
+int32_t dosio_seek(DOSIO_HANDLE* io, int32_t ofs, int16_t whence) {
+  if (fseek(host_files[ io->fd ], ofs, whence) != 0) return -1;
+  io->file_ofs = ftell(host_files[ io->fd ]);
+  return 0;
+}
+
+size_t dosio_tell(DOSIO_HANDLE* io) {
+  return io->file_ofs;
+}
+
+size_t dosio_get_size(DOSIO_HANDLE* io) {
+  return io->file_bytes;
+}
+
+//
+//  native to big endian
+//
+static void write_be32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+//
+//  .s44 to .z44
+//
+static int32_t encode(FILE* fp_in, FILE* fp_out) {
+
+  int32_t rc = -1;
+  uint8_t* s44_data = NULL;
+  int16_t* pcm_data = NULL;
+  uint32_t* block_bytes = NULL;
+
+  // read whole .s44 data
+  fseek(fp_in, 0, SEEK_END);
+  size_t s44_bytes = ftell(fp_in);
+  fseek(fp_in, 0, SEEK_SET);
+  s44_data = malloc(s44_bytes + 1);
+  pcm_data = malloc(s44_bytes + 4);
+  if (s44_data == NULL || pcm_data == NULL) goto exit;
+  if (fread(s44_data, 1, s44_bytes, fp_in) != s44_bytes) goto exit;
+
+  uint32_t num_frames = s44_bytes / 4;
+  uint32_t num_blocks = (num_frames + Z44_BLOCK_FRAMES - 1) / Z44_BLOCK_FRAMES;
+  memcpy(pcm_data, s44_data, num_frames * 4);       // z44 blocks take big endian words as they are in .s44
+
+  // header and dummy index
+  uint8_t header[ Z44_HEADER_BYTES ];
+  memcpy(header, Z44_EYE_CATCH, 4);
+  header[4] = 0;
+  header[5] = Z44_VERSION;
+  header[6] = 0;
+  header[7] = 2;
+  write_be32(header + 8, num_frames);
+  write_be32(header + 12, Z44_BLOCK_FRAMES);
+  fwrite(header, 1, Z44_HEADER_BYTES, fp_out);
+
+  block_bytes = calloc(num_blocks + 1, sizeof(uint32_t));
+  if (block_bytes == NULL) goto exit;
+  long index_ofs = ftell(fp_out);
+  for (uint32_t i = 0; i < num_blocks; i++) {
+    uint8_t b[4] = { 0 };
+    fwrite(b, 1, 4, fp_out);
+  }
+
+  // blocks
+  static uint8_t block[ Z44_MAX_BLOCK_BYTES ];
+  size_t total_bytes = Z44_HEADER_BYTES + num_blocks * 4;
+  for (uint32_t i = 0; i < num_blocks; i++) {
+    size_t frames = (i == num_blocks - 1) ? num_frames - i * Z44_BLOCK_FRAMES : Z44_BLOCK_FRAMES;
+    block_bytes[i] = z44_encode_block(pcm_data + i * Z44_BLOCK_FRAMES * 2, frames, block);
+    fwrite(block, 1, block_bytes[i], fp_out);
+    total_bytes += block_bytes[i];
+  }
+
+  // index
+  fseek(fp_out, index_ofs, SEEK_SET);
+  for (uint32_t i = 0; i < num_blocks; i++) {
+    uint8_t b[4];
+    write_be32(b, block_bytes[i]);
+    fwrite(b, 1, 4, fp_out);
+  }
+
+  printf("%zu -> %zu bytes (%4.1f%%)\n", s44_bytes, total_bytes, total_bytes * 100.0 / (s44_bytes ? s44_bytes : 1));
+  if (s44_bytes & 0x03) {
+    printf("warn: %zu trailing bytes were dropped.\n", s44_bytes & 0x03);
+  }
+
+  rc = 0;
+
+exit:
+  if (block_bytes != NULL) free(block_bytes);
+  if (pcm_data != NULL) free(pcm_data);
+  if (s44_data != NULL) free(s44_data);
+  return rc;
+}
+
+//
+//  .z44 to .s44
+//
+static int32_t decode(char* in_file, FILE* fp_out) {
+
+  int32_t rc = -1;
+  DOSIO_HANDLE io = { 0 };
+  Z44_HANDLE z44 = { 0 };
+  uint8_t* buffer = NULL;
+  int16_t* pcm_data = NULL;
+
+  if (dosio_open(&io, (uint8_t*)in_file) != 0) goto exit;
+  if (z44_init(&z44, &io) != 0) goto exit;
+
+  size_t buffer_bytes = Z44_MAX_BLOCK_BYTES * 16;
+  size_t pcm_len = Z44_BLOCK_FRAMES * 2 * 16;
+  buffer = malloc(buffer_bytes);
+  pcm_data = malloc(pcm_len * sizeof(int16_t));
+  if (buffer == NULL || pcm_data == NULL) goto exit;
+
+  size_t len;
+  while ((len = z44_read(&z44, &io, buffer, buffer_bytes, pcm_data, pcm_len)) > 0) {
+    fwrite(pcm_data, sizeof(int16_t), len, fp_out);
+  }
+  if (z44.current_block != z44.num_blocks) goto exit;
+
+  rc = 0;
+
+exit:
+  z44_close(&z44);
+  dosio_close(&io);
+  if (pcm_data != NULL) free(pcm_data);
+  if (buffer != NULL) free(buffer);
+  return rc;
+}
+
+//
+//  main
+//
+int main(int argc, char* argv[]) {
+
+  int32_t rc = -1;
+  FILE* fp_in = NULL;
+  FILE* fp_out = NULL;
+
+  if (argc < 3 || (strcmp(argv[1], "-d") == 0 && argc < 4)) {
+    printf("usage: z44conv <in.s44> <out.z44>\n");
+    printf("       z44conv -d <in.z44> <out.s44>\n");
+    goto exit;
+  }
+
+  int16_t decode_mode = strcmp(argv[1], "-d") == 0 ? 1 : 0;
+  char* in_file = argv[ 1 + decode_mode ];
+  char* out_file = argv[ 2 + decode_mode ];
+
+  fp_in = fopen(in_file, "rb");
+  if (fp_in == NULL) {
+    printf("error: file open error. (%s)\n", in_file);
+    goto exit;
+  }
+
+  fp_out = fopen(out_file, "wb");
+  if (fp_out == NULL) {
+    printf("error: file create error. (%s)\n", out_file);
+    goto exit;
+  }
+
+  if ((decode_mode ? decode(in_file, fp_out) : encode(fp_in, fp_out)) != 0) {
+    printf("error: conversion error. (%s)\n", in_file);
+    goto exit;
+  }
+
+  rc = 0;
+
+exit:
+  if (fp_out != NULL) fclose(fp_out);
+  if (fp_in != NULL) fclose(fp_in);
+  return rc == 0 ? 0 : 1;
+}